@@ -0,0 +1,51 @@
+#pragma once
+
+#include "sdf.h"
+
+/* Node of an adaptive distance field */
+// The cube of a node is derived from its path from the root,
+// so only the corner samples and the children are stored.
+typedef struct {
+  int children; // index of the first of 8 children, -1 for a leaf
+  float d[8];   // signed distance at the corners, x first, then y, z
+} AdfNode;
+
+// The 8 children of a node are contiguous, child c is at
+// children + c, where bit 0, 1, 2 of c select the upper half in x, y, z.
+
+/* Adaptive distance field */
+// [Frisken,2000] An octree whose cells are subdivided only where the
+// trilinear interpolation of the corners differs from the exact distance
+// by more than a tolerance. Flat regions end up in a few large cells,
+// thin features like the ears of the bunny in small ones.
+// Only cells within maxDistance of the surface are refined, since
+// the far field is smooth but creased along the medial axis, where
+// the error would otherwise drive cells down to maxDepth.
+// Queries follow Grid, positions are in world space and points outside
+// the root cube return 9999.
+// A node costs 9 times a cell of Grid, so the adf is smaller than the
+// uniform grid of its finest cells only when that grid is fine, and its
+// error grows with the tolerance, see benchAdf.
+class Adf {
+public:
+  /* Members */
+  vec3 origin;          // lower corner of the root cube
+  float size;           // side of the root cube
+  int maxDepth;         // a cell at maxDepth has side size / 2^maxDepth
+  float tolerance;      // max interpolation error of a leaf
+  float maxDistance;    // cells farther from the surface are not refined
+  vector<AdfNode> nodes; // nodes[0] is the root
+
+  /* Member functions */
+  int findLeaf(vec3, vec3 &, float &);
+  float getDistance(vec3);
+  float getDistanceGradient(vec3, vec3 &);
+  vec3 getGradient(vec3);
+  int getNumLeaves();
+
+  /* Constructors */
+  Adf()
+      : origin(0), size(1.f), maxDepth(0), tolerance(0.f),
+        maxDistance(9999.f) {}
+  ~Adf() {}
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+// alignment of SIMD arrays, one cache line
+#define SIMD_ALIGNMENT 64
+
+/* Allocator for std::vector with cache line aligned storage */
+template <typename T> class AlignedAllocator {
+public:
+  typedef T value_type;
+
+  AlignedAllocator() {}
+  template <typename U> AlignedAllocator(const AlignedAllocator<U> &) {}
+
+  T *allocate(size_t n) {
+    return static_cast<T *>(
+        ::operator new(n * sizeof(T), std::align_val_t(SIMD_ALIGNMENT)));
+  }
+
+  void deallocate(T *p, size_t) {
+    ::operator delete(p, std::align_val_t(SIMD_ALIGNMENT));
+  }
+};
+
+template <typename T, typename U>
+bool operator==(const AlignedAllocator<T> &, const AlignedAllocator<U> &) {
+  return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const AlignedAllocator<T> &, const AlignedAllocator<U> &) {
+  return false;
+}
+
+typedef std::vector<float, AlignedAllocator<float>> FloatArray;
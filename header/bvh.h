@@ -0,0 +1,37 @@
+#pragma once
+
+#include "mesh.h"
+#include "sdf.h"
+#include "triangleSet.h"
+
+/* Define a node of the bounding volume hierarchy */
+typedef struct {
+  vec3 min, max;     // aabb of all triangles below this node
+  int left, right;   // children, -1 if this node is a leaf
+  int first, count;  // triangles of a leaf, i.e. tris[first, first + count)
+} BvhNode;
+
+/* Bounding volume hierarchy over Mesh::faces */
+// Used to find the closest triangle of a point
+// without iterating all the faces of the mesh.
+class Bvh {
+public:
+  /* Members */
+  vector<BvhNode> nodes; // nodes[0] is the root
+  vector<int> triIdxs;   // face indices, reordered so that a leaf is a range
+  TriangleSet tris;      // triangles in the order of triIdxs
+
+  /* Member functions */
+  void build(Mesh &);
+  float getDistance(vec3);
+  float getDistance(vec3, float, int &);
+
+  /* Constructors */
+  Bvh() {}
+  ~Bvh() {}
+
+private:
+  int buildNode(vector<vec3> &, vector<vec3> &, vector<vec3> &, int, int);
+};
+
+float distPoint2Box(vec3, vec3, vec3);
@@ -1,3 +1,5 @@
+#pragma once
+
 #include <iostream>
 #include <cstdlib>
 #include <ctime>
@@ -16,6 +18,9 @@
 #include <GLFW/glfw3.h>
 #include <FreeImage.h>
 
+#include "mesh.h"
+#include "particleSystem.h"
+
 #define WINDOW_WIDTH 800
 #define WINDOW_HEIGHT 600
 
@@ -35,11 +40,11 @@ typedef struct {
   float m;
 } Point;
 
-/* Define a particle system */
+/* Buffers to draw a particle system */
 class Particles {
 public:
-  std::vector<Point> Ps;
   GLuint vao, vboPos, vboColor;
+  std::vector<GLfloat> aPos; // interleaved positions, see drawPoints()
 
   /* Constructors */
   Particles() {}
@@ -50,54 +55,16 @@ public:
   }
 };
 
-typedef struct {
-  // data index
-  GLuint v1, v2, v3;
-  GLuint vt1, vt2, vt3;
-  GLuint vn1, vn2, vn3;
-} Face;
-
-class Mesh {
-public:
-  std::vector<glm::vec3> vertices;
-  std::vector<glm::vec2> uvs;
-  std::vector<glm::vec3> faceNormals;
-  std::vector<Face> faces;
-
-  // opengl data
-  GLuint vboVtxs, vboUvs, vboNormals;
-  GLuint vao;
-
-  // aabb
-  glm::vec3 min, max;
-
-  /* Constructors */
-  Mesh(){};
-  ~Mesh() {
-    glDeleteBuffers(1, &vboVtxs);
-    glDeleteBuffers(1, &vboUvs);
-    glDeleteBuffers(1, &vboNormals);
-    glDeleteVertexArrays(1, &vao);
-  };
-
-  /* Member functions */
-  void translate(glm::vec3);
-  void scale(glm::vec3);
-  void rotate(glm::vec3);
-};
-
-std::string readFile(const std::string);
-Mesh loadObj(std::string);
 GLuint buildShader(string, string);
 GLuint compileShader(string, GLenum);
 GLuint linkShader(GLuint, GLuint);
 void createMesh(Mesh &);
+void releaseMesh(Mesh &);
 void printLog(GLuint &);
 GLint myGetUniformLocation(GLuint &, std::string);
-void findAABB(Mesh &);
 void drawBox(glm::vec3, glm::vec3);
 void updateMesh(Mesh &);
 void drawTriangle(Triangle &);
 void drawLine(vec3, vec3);
 void drawPoints(std::vector<Point> &);
-void drawPoints(Particles &);
+void drawPoints(Particles &, ParticleSystem &);
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/* A file mapped read-only into memory */
+// The pages are loaded by the OS on first access,
+// so nothing is read or copied when the file is opened.
+class MappedFile {
+public:
+  /* Members */
+  const char *data; // NULL if not mapped or empty
+  size_t size;      // in bytes
+
+  /* Member functions */
+  bool open(const string);
+  void close();
+
+  /* Constructors */
+  MappedFile() : data(NULL), size(0) {}
+  ~MappedFile() { close(); }
+
+  // the mapping is owned by one object
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+};
+
+void splitLines(const char *, const char *, int, vector<const char *> &);
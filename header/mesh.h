@@ -0,0 +1,65 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "mappedFile.h"
+#include "threadPool.h"
+
+using namespace std;
+using namespace glm;
+
+// index of a missing uv or normal of a face
+#define MESH_NO_INDEX 0xffffffffu
+
+// binary cache of a parsed obj file, see writeMeshCache()
+#define MESH_CACHE_MAGIC "MSH1"
+#define MESH_CACHE_VERSION 1
+
+typedef struct {
+  // data index
+  unsigned int v1, v2, v3;
+  unsigned int vt1, vt2, vt3;
+  unsigned int vn1, vn2, vn3;
+} Face;
+
+/* Triangle mesh loaded from an obj file */
+// No OpenGL here, so the sdf core can be used on machines without a display.
+// The opengl buffers are created by createMesh() and
+// released by releaseMesh() in common.cpp.
+class Mesh {
+public:
+  std::vector<glm::vec3> vertices;
+  std::vector<glm::vec2> uvs;
+  std::vector<glm::vec3> faceNormals;
+  std::vector<Face> faces;
+
+  // opengl data (GLuint)
+  unsigned int vboVtxs, vboUvs, vboNormals;
+  unsigned int vao;
+
+  // aabb
+  glm::vec3 min, max;
+
+  /* Constructors */
+  Mesh() : vboVtxs(0), vboUvs(0), vboNormals(0), vao(0){};
+  ~Mesh(){};
+
+  /* Member functions */
+  void translate(glm::vec3);
+  void scale(glm::vec3);
+  void rotate(glm::vec3);
+};
+
+std::string readFile(const std::string);
+Mesh loadObj(std::string);
+Mesh loadObj(std::string, ThreadPool &);
+Mesh parseObj(const std::string, ThreadPool &);
+string meshCacheName(const string);
+bool readMeshCache(Mesh &, const string);
+void writeMeshCache(Mesh &, const string);
+void findAABB(Mesh &);
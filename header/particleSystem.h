@@ -0,0 +1,116 @@
+#pragma once
+
+#include "sdfPyramid.h"
+#include "spatialHash.h"
+#include "threadPool.h"
+
+// # of particles integrated together, see ParticleSystem::step()
+#define PARTICLE_BLOCK 256
+
+// # of blocks per task of step()
+#define PARTICLE_GRAIN 16
+
+/* Particles colliding with a signed distance field */
+// Positions, velocities and masses are stored as separate arrays,
+// so a step streams only the arrays it needs and the sdf is queried
+// SIMD_LANES particles at a time with plain vector loads.
+// Colors belong to rendering and are not stored here.
+//
+// step() cuts the particles into blocks of PARTICLE_BLOCK at fixed
+// indices and integrates the blocks in parallel.
+//
+// reorder() sorts the particles along a Morton curve every
+// reorderInterval steps, so that particles close in space are close in
+// memory and a block reads few cache lines of the grid. ids keeps the
+// index each particle had in the order of add().
+//
+// Particles closer than 2 * contactRadius collide with each other,
+// see collideParticles(). Contacts read the state at the beginning of
+// the step and visit neighbours in the order of the spatial hash, so
+// the result does not depend on the # of threads either.
+//
+// A particle whose speed and displacement stay below sleepSpeed and
+// sleepDistance for sleepSteps steps in a row falls asleep: it stops,
+// and step() skips it. Awake particles are kept in [0, nOfActive) and
+// sleeping ones after them, and particles fall asleep together once
+// every sleepSteps steps, so a step costs O(nOfActive) plus the build
+// of sleepHash spread over sleepSteps steps. Sleeping particles are
+// still obstacles for the awake ones, and wake up when an awake
+// particle faster than sleepSpeed touches them, or when the sdf moves
+// while they are near it, see updateSleep().
+class ParticleSystem {
+public:
+  /* Members */
+  vector<float> px, py, pz; // positions
+  vector<float> vx, vy, vz; // velocities
+  vector<float> m;          // masses
+  vector<int> ids;          // index in the order of add()
+  vector<int> stillSteps;   // # of still steps in a row, see sleepSteps
+  int nOfActive;            // awake particles are [0, nOfActive)
+
+  vec3 gravity;
+  float dt;
+  float collisionDistance; // closer particles bounce off the surface
+  float friction;          // velocity scale of a bounce
+  float broadTolerance;    // error bound of the broad phase level
+  float contactRadius;     // of a particle, 0 for no particle contacts
+  int reorderInterval;     // # of steps between reorders, 0 for never
+  int sleepSteps;          // # of still steps before sleeping, 0 for never
+  float sleepSpeed;        // max speed of a still particle, above
+                           // |gravity| * dt for particles resting on a floor
+  float sleepDistance;     // max displacement in a step of a still particle
+  int nOfSteps;            // # of steps so far
+  int nOfReorders;         // # of reorders so far
+  double hashTime;         // seconds of the hash builds of the last contacts
+
+  SpatialHash hash;      // of the awake particles at the last contacts
+  SpatialHash sleepHash; // of the sleeping particles
+
+  /* Member functions */
+  void clear();
+  void add(vec3, vec3, float);
+  int size() { return px.size(); }
+  vec3 getPos(int i) { return vec3(px[i], py[i], pz[i]); }
+  vec3 getVelocity(int i) { return vec3(vx[i], vy[i], vz[i]); }
+  void step(SdfPyramid &, ThreadPool &);
+  int collideParticles(ThreadPool &);
+  void reorder(Grid &, ThreadPool &);
+  void wakeAll();
+
+  /* Constructors */
+  ParticleSystem()
+      : nOfActive(0), gravity(0, -9.8f, 0), dt(0.01f),
+        collisionDistance(0.1f), friction(0.3f), broadTolerance(0.25f),
+        contactRadius(0.f), reorderInterval(0), sleepSteps(0),
+        sleepSpeed(0.1f), sleepDistance(0.001f), nOfSteps(0),
+        nOfReorders(0), hashTime(0), sleepHashValid(false), sleepBase(0),
+        nearBits(0), colliderOrigin(0) {}
+  ~ParticleSystem() {}
+
+private:
+  // positions and velocities after collideParticles(), or all arrays
+  // of a range of particles in permute()
+  vector<float> newPx, newPy, newPz, newVx, newVy, newVz;
+  vector<float> newM;
+  vector<int> newIds, newStillSteps;
+
+  // sorting keys and order of reorder() and updateSleep()
+  vector<uint32_t> sortKeys;
+  vector<int> sortOrder;
+
+  vector<int> wakeIdxs;       // sleeping particles touched in the last contacts
+  bool sleepHashValid;        // false when particles fell asleep
+  int sleepBase;              // first sleeping particle of sleepHash
+  vector<int> sleepSlots;     // sorted point of sleepHash of each particle
+  vector<uint64_t> sleepNear; // 1 bit per cell, see collideParticles()
+  ivec3 nearBits;             // bits of the cell of sleepNear along each axis
+  vec3 colliderOrigin;        // of the sdf in the last step
+
+  void stepBlock(SdfPyramid &, int, int);
+  void updateSleep(SdfPyramid &, ThreadPool &);
+  int partition(int, int, ThreadPool &);
+  void permute(int, const vector<int> &, ThreadPool &);
+  void swapParticles(int, int);
+  void wake(int);
+  uint32_t getNearKey(ivec3);
+};
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "threadPool.h"
+
+#include <cstdint>
+
+// # of key bits sorted by one counting pass
+#define RADIX_BITS 8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+
+// # of elements counted by one task of a pass
+#define RADIX_BLOCK 65536
+
+/* Parallel LSD radix sort of 32-bit keys */
+// Each pass is a counting sort on RADIX_BITS bits: the blocks count
+// their digits in parallel, a prefix sum over (digit, block) gives
+// where each block writes each digit, then the blocks scatter in
+// parallel. Blocks are cut at fixed indices and each one scatters in
+// order, so the sort is stable and the result does not depend on the
+// # of threads.
+void radixSort(vector<uint32_t> &, vector<int> &, int, ThreadPool &);
@@ -1,3 +1,5 @@
+#pragma once
+
 #include <iostream>
 #include <string>
 #include <vector>
@@ -13,30 +15,79 @@
 using namespace std;
 using namespace glm;
 
-typedef struct {
-  ivec3 idx; // index (i, j, k) in grid space
-  vec3 pos;  // position in world space
-  float sd;  // signed distance
-} Node, Cell;
+// if two distances differ less than this threshold,
+// we regard them as equal (see the special case in README)
+#define TIE_EPSILON 0.0001f
+
+// if P is this close to the plane of the closest triangle,
+// we regard P as outside the mesh
+#define SIGN_EPSILON 0.01f
+
+/* Storage layouts of Grid */
+#define GRID_LINEAR 0  // hash order, x first
+#define GRID_BRICKED 1 // bricks of BRICK_SIZE^3 cells in Morton order
 
+// # of cells along each side of a brick, a power of 2
+#define BRICK_LOG2 3
+#define BRICK_SIZE (1 << BRICK_LOG2)
+#define BRICK_CELLS (BRICK_SIZE * BRICK_SIZE * BRICK_SIZE)
+
+/* Signed distance field sampled on a regular grid */
+// Only the samples are stored. The index and the position of a cell
+// are derived from its hash, so a cell costs 4 bytes instead of 28.
+// hash = i + j * nOfCells.x + k * nOfCells.x * nOfCells.y
+// Queries read samples, which points either to sd
+// or to a binary sdf file mapped by mapSdf() (see sdfIO.h).
+//
+// In the linear layout a sample is stored at its hash.
+// In the bricked layout the cells of a BRICK_SIZE^3 brick are
+// contiguous and bricks are stored in Morton order, so neighbours in
+// any direction are usually in the same few cache lines.
+// getOffset() gives where a cell is stored in either layout.
+// Generation writes sd by hash, i.e. it works on linear grids,
+// and setLayout() converts the result.
 class Grid {
 public:
   /* Members */
-  vector<Cell> cells; // use hash to access each cell
+  vector<float> sd; // signed distance of each cell, use getOffset()
+  const float *samples; // sd.data(), or read-only samples of a mapped file
   vec3 origin;
   float cellSize;
   ivec3 nOfCells;
 
+  int layout;              // GRID_LINEAR or GRID_BRICKED
+  ivec3 nOfBricks;         // bricked layout only
+  vector<int> brickOffsets; // first sample of each brick, in hash order
+
   /* Member functions */
+  void init(vec3, float, ivec3, float, int layout = GRID_LINEAR);
+  void initLayout(int);
+  void setLayout(int);
+  size_t size();
+  size_t getStorageSize();
+  int getHash(ivec3);
+  int getOffset(ivec3);
+  ivec3 getIdx(int);
+  vec3 getPos(ivec3);
+  vec3 getPos(int);
   float getDistance(vec3);
   float getDistance(int);
+  float getDistanceGradient(vec3, vec3 &);
+  void getDistanceGradients(const vec3 *, int, float *, vec3 *);
+  void getDistanceGradients(const float *, const float *, const float *, int,
+                            float *, float *, float *, float *);
   vec3 getGradient(vec3);
   vec3 getGradient2(vec3);
   int calCellHash(vec3);
 
   /* Constructors */
-  Grid() {}
+  Grid()
+      : samples(NULL), origin(0), cellSize(0.1f), nOfCells(0),
+        layout(GRID_LINEAR), nOfBricks(0) {}
+  Grid(const Grid &);
   ~Grid() {}
+
+  Grid &operator=(const Grid &);
 };
 
 vec2 lineUv(vec3, vec3, vec3);
@@ -44,4 +95,6 @@ float signedArea(vec3, vec3, vec3);
 vec3 baryCoord(vec3, vec3, vec3, vec3, vec3);
 vec3 point2plane(vec3, vec3, vec3, vec3, vec3);
 float distPoint2Triangle(vec3, vec3, vec3, vec3, vec3);
+float mergeDistance(float, float);
 int calCellHash(vec3, ivec3, float);
+unsigned int mortonCode(ivec3);
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "sdf.h"
+#include "adf.h"
+#include "sparseGrid.h"
+#include "bvh.h"
+#include "triangleSet.h"
+#include "threadPool.h"
+#include "windingNumber.h"
+
+/* Generation modes of createSdf */
+#define GEN_EXACT 0       // exact distance of every cell in the range
+#define GEN_NARROW_BAND 1 // exact near the surface, sweeping elsewhere
+#define GEN_SPARSE 2      // exact near the surface, tiles elsewhere
+#define GEN_ADF 3         // octree refined by the interpolation error
+#define GEN_COARSE_TO_FINE 4 // exact near the surface, interpolated elsewhere
+
+/* Sign modes of createSdf */
+#define SIGN_NORMAL 0 // sign of dot(P - A, N) of the closest triangle
+#define SIGN_PARITY 1 // parity of ray crossings along grid rows
+#define SIGN_WINDING 2 // fast winding number, for meshes with holes
+
+void generateSdfExact(Grid &, Bvh &, ThreadPool &, ivec3, ivec3, bool);
+void generateSdfNarrowBand(Grid &, TriangleSet &, ThreadPool &, int);
+void computeInsideParity(Grid &, TriangleSet &, ThreadPool &, vector<char> &);
+void computeInsideWinding(Grid &, WindingNumber &, ThreadPool &,
+                          vector<char> &);
+void applySign(Grid &, vector<char> &);
+void generateSdfSparse(SparseGrid &, Bvh &, WindingNumber *, ThreadPool &,
+                       int);
+void generateAdf(Adf &, Bvh &, WindingNumber *, ThreadPool &);
+void generateSdfCoarseToFine(Grid &, Bvh &, WindingNumber *, ThreadPool &,
+                             int);
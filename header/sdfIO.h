@@ -0,0 +1,107 @@
+#pragma once
+
+#include "sdf.h"
+#include "sparseGrid.h"
+#include "adf.h"
+#include "sdfPyramid.h"
+#include "mappedFile.h"
+#include "threadPool.h"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+
+/* Binary sdf file */
+// [header (64 bytes)][samples]
+// Samples are raw little-endian values in the storage order of the grid
+// layout, so a mapped file is used as the grid without parsing or copying.
+#define SDF_MAGIC "SDF3"
+#define SDF_VERSION 1
+#define SDF_EXTENSION ".sdf"
+
+// value types
+#define SDF_FLOAT32 0
+
+// layouts
+#define SDF_LAYOUT_LINEAR GRID_LINEAR   // hash = i + j * nx + k * nx * ny
+#define SDF_LAYOUT_BRICKED GRID_BRICKED // 8^3 bricks in Morton order
+
+typedef struct {
+  char magic[4];       // SDF_MAGIC
+  uint32_t version;    // SDF_VERSION
+  int32_t nOfCells[3]; // nx, ny, nz
+  float origin[3];
+  float cellSize;
+  uint32_t valueType;  // SDF_FLOAT32
+  uint32_t layout;     // SDF_LAYOUT_LINEAR or SDF_LAYOUT_BRICKED
+  uint32_t dataOffset; // offset of the samples from the file start, in bytes
+  uint32_t reserved[4];
+} SdfHeader;
+
+static_assert(sizeof(SdfHeader) == 64, "SdfHeader must be 64 bytes");
+
+/* Binary sparse sdf file */
+// [header (64 bytes)][root entries][node children][node tiles]
+// [leaf indices][leaf samples]
+// Arrays are the members of SparseGrid as they are in memory,
+// root entries are sorted by their key.
+#define SPARSE_SDF_MAGIC "SDFV"
+#define SPARSE_SDF_VERSION 1
+
+typedef struct {
+  int32_t idx[3]; // index of the internal node
+  int32_t node;   // node index, or SPARSE_TILE
+  float tile;
+} SparseRootRecord;
+
+typedef struct {
+  char magic[4];       // SPARSE_SDF_MAGIC
+  uint32_t version;    // SPARSE_SDF_VERSION
+  int32_t nOfCells[3]; // nx, ny, nz
+  float origin[3];
+  float cellSize;
+  float background;
+  uint32_t nOfRootEntries;
+  uint32_t nOfNodes;
+  uint32_t nOfLeaves;
+  uint32_t reserved[3];
+} SparseSdfHeader;
+
+static_assert(sizeof(SparseSdfHeader) == 64,
+              "SparseSdfHeader must be 64 bytes");
+
+void writeSdf(Grid &, const string);
+void readSdf(Grid &, const string);
+void readSdfBatty(Grid &, const string);
+void readSdfBatty(Grid &, const string, ThreadPool &);
+void writeSdfBinary(Grid &, const string);
+bool mapSdf(Grid &, MappedFile &, const string);
+bool isBinarySdf(const string);
+string sdfLevelName(const string, int);
+int mapSdfPyramid(SdfPyramid &, Grid &, MappedFile *, const string);
+/* Binary adaptive distance field file */
+// [header (64 bytes)][nodes]
+#define ADF_MAGIC "SDFA"
+#define ADF_VERSION 1
+
+static_assert(sizeof(AdfNode) == 36, "AdfNode must be 36 bytes");
+
+typedef struct {
+  char magic[4];     // ADF_MAGIC
+  uint32_t version;  // ADF_VERSION
+  float origin[3];
+  float size;
+  int32_t maxDepth;
+  float tolerance;
+  float maxDistance;
+  uint32_t nOfNodes;
+  uint32_t reserved[6];
+} AdfHeader;
+
+static_assert(sizeof(AdfHeader) == 64, "AdfHeader must be 64 bytes");
+
+void writeSparseSdf(SparseGrid &, const string);
+bool readSparseSdf(SparseGrid &, const string);
+bool isSparseSdf(const string);
+void writeAdf(Adf &, const string);
+bool readAdf(Adf &, const string);
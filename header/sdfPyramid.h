@@ -0,0 +1,36 @@
+#pragma once
+
+#include "sdf.h"
+#include "threadPool.h"
+
+// max # of levels, including the full resolution grid
+#define PYRAMID_MAX_LEVELS 8
+
+/* Mip chain of a signed distance field */
+// Level l has cellSize * 2^l and shares the origin of level 0.
+// A coarse sample is the min of the finer samples of the 8 cells around
+// it, so at any point the trilinear distance of a coarse level is at most
+// the one of level 0, i.e. a coarse level never misses a collision.
+// It is below level 0 by at most getErrorBound(l) if the samples of
+// level 0 are 1-Lipschitz, i.e. free of sign errors.
+class SdfPyramid {
+public:
+  /* Members */
+  Grid *fine;          // level 0, not owned
+  vector<Grid> coarse; // coarse[l - 1] is level l
+
+  /* Member functions */
+  void build(Grid &, int, ThreadPool &);
+  int getNumLevels() { return 1 + coarse.size(); }
+  Grid &getGrid(int);
+  float getErrorBound(int);
+  int getLevel(float);
+  float getDistance(vec3, float);
+  float getDistanceGradient(vec3, vec3 &, float);
+
+  /* Constructors */
+  SdfPyramid() : fine(NULL) {}
+  ~SdfPyramid() {}
+};
+
+Grid downsampleMin(Grid &, ThreadPool &);
@@ -0,0 +1,141 @@
+#pragma once
+
+// # of floats processed at once by the batched kernels
+#if defined(__AVX512F__)
+#define SIMD_LANES 16
+#elif defined(__AVX2__)
+#define SIMD_LANES 8
+#else
+#define SIMD_LANES 1
+#endif
+
+#if SIMD_LANES > 1
+#include <immintrin.h>
+
+/* A thin layer over AVX-512 / AVX2 */
+// so that each batched kernel is written only once
+#if SIMD_LANES == 16
+typedef __m512 vfloat;
+typedef __m512i vint;
+typedef __mmask16 vmask;
+
+static inline vfloat vLoad(const float *p) { return _mm512_loadu_ps(p); }
+static inline void vStore(float *p, vfloat a) { _mm512_storeu_ps(p, a); }
+static inline vfloat vSet(float a) { return _mm512_set1_ps(a); }
+static inline vfloat vAdd(vfloat a, vfloat b) { return _mm512_add_ps(a, b); }
+static inline vfloat vSub(vfloat a, vfloat b) { return _mm512_sub_ps(a, b); }
+static inline vfloat vMul(vfloat a, vfloat b) { return _mm512_mul_ps(a, b); }
+static inline vfloat vDiv(vfloat a, vfloat b) { return _mm512_div_ps(a, b); }
+static inline vfloat vSqrt(vfloat a) { return _mm512_sqrt_ps(a); }
+static inline vfloat vMin(vfloat a, vfloat b) { return _mm512_min_ps(a, b); }
+static inline vfloat vMax(vfloat a, vfloat b) { return _mm512_max_ps(a, b); }
+static inline vfloat vFloor(vfloat a) {
+  return _mm512_roundscale_ps(a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+}
+static inline vmask vLe(vfloat a, vfloat b) {
+  return _mm512_cmp_ps_mask(a, b, _CMP_LE_OQ);
+}
+static inline vmask vLt(vfloat a, vfloat b) {
+  return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ);
+}
+static inline vmask vAnd(vmask a, vmask b) { return a & b; }
+// m ? a : b
+static inline vfloat vSelect(vmask m, vfloat a, vfloat b) {
+  return _mm512_mask_blend_ps(m, b, a);
+}
+
+static inline vint vSetInt(int a) { return _mm512_set1_epi32(a); }
+// 0, 1, 2, ...
+static inline vint vLaneIdx() {
+  return _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14,
+                           15);
+}
+static inline vint vToInt(vfloat a) { return _mm512_cvttps_epi32(a); }
+static inline vfloat vToFloat(vint a) { return _mm512_cvtepi32_ps(a); }
+static inline vint vAddInt(vint a, vint b) { return _mm512_add_epi32(a, b); }
+static inline vint vMulInt(vint a, vint b) { return _mm512_mullo_epi32(a, b); }
+static inline vint vMinInt(vint a, vint b) { return _mm512_min_epi32(a, b); }
+static inline vint vMaxInt(vint a, vint b) { return _mm512_max_epi32(a, b); }
+static inline vint vAndInt(vint a, int b) {
+  return _mm512_and_si512(a, _mm512_set1_epi32(b));
+}
+static inline vint vShlInt(vint a, int n) { return _mm512_slli_epi32(a, n); }
+static inline vint vShrInt(vint a, int n) { return _mm512_srli_epi32(a, n); }
+static inline vfloat vGather(const float *base, vint idx) {
+  return _mm512_i32gather_ps(idx, base, 4);
+}
+// m ? base[idx] : 0, lanes out of m are not loaded
+static inline vfloat vGather(const float *base, vint idx, vmask m) {
+  return _mm512_mask_i32gather_ps(_mm512_setzero_ps(), m, idx, base, 4);
+}
+static inline vint vGatherInt(const int *base, vint idx, vmask m) {
+  return _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), m, idx, base, 4);
+}
+#else
+typedef __m256 vfloat;
+typedef __m256i vint;
+typedef __m256 vmask;
+
+static inline vfloat vLoad(const float *p) { return _mm256_loadu_ps(p); }
+static inline void vStore(float *p, vfloat a) { _mm256_storeu_ps(p, a); }
+static inline vfloat vSet(float a) { return _mm256_set1_ps(a); }
+static inline vfloat vAdd(vfloat a, vfloat b) { return _mm256_add_ps(a, b); }
+static inline vfloat vSub(vfloat a, vfloat b) { return _mm256_sub_ps(a, b); }
+static inline vfloat vMul(vfloat a, vfloat b) { return _mm256_mul_ps(a, b); }
+static inline vfloat vDiv(vfloat a, vfloat b) { return _mm256_div_ps(a, b); }
+static inline vfloat vSqrt(vfloat a) { return _mm256_sqrt_ps(a); }
+static inline vfloat vMin(vfloat a, vfloat b) { return _mm256_min_ps(a, b); }
+static inline vfloat vMax(vfloat a, vfloat b) { return _mm256_max_ps(a, b); }
+static inline vfloat vFloor(vfloat a) { return _mm256_floor_ps(a); }
+static inline vmask vLe(vfloat a, vfloat b) {
+  return _mm256_cmp_ps(a, b, _CMP_LE_OQ);
+}
+static inline vmask vLt(vfloat a, vfloat b) {
+  return _mm256_cmp_ps(a, b, _CMP_LT_OQ);
+}
+static inline vmask vAnd(vmask a, vmask b) { return _mm256_and_ps(a, b); }
+// m ? a : b
+static inline vfloat vSelect(vmask m, vfloat a, vfloat b) {
+  return _mm256_blendv_ps(b, a, m);
+}
+
+static inline vint vSetInt(int a) { return _mm256_set1_epi32(a); }
+// 0, 1, 2, ...
+static inline vint vLaneIdx() {
+  return _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+}
+static inline vint vToInt(vfloat a) { return _mm256_cvttps_epi32(a); }
+static inline vfloat vToFloat(vint a) { return _mm256_cvtepi32_ps(a); }
+static inline vint vAddInt(vint a, vint b) { return _mm256_add_epi32(a, b); }
+static inline vint vMulInt(vint a, vint b) { return _mm256_mullo_epi32(a, b); }
+static inline vint vMinInt(vint a, vint b) { return _mm256_min_epi32(a, b); }
+static inline vint vMaxInt(vint a, vint b) { return _mm256_max_epi32(a, b); }
+static inline vint vAndInt(vint a, int b) {
+  return _mm256_and_si256(a, _mm256_set1_epi32(b));
+}
+static inline vint vShlInt(vint a, int n) { return _mm256_slli_epi32(a, n); }
+static inline vint vShrInt(vint a, int n) { return _mm256_srli_epi32(a, n); }
+static inline vfloat vGather(const float *base, vint idx) {
+  return _mm256_i32gather_ps(base, idx, 4);
+}
+// m ? base[idx] : 0, lanes out of m are not loaded
+static inline vfloat vGather(const float *base, vint idx, vmask m) {
+  return _mm256_mask_i32gather_ps(_mm256_setzero_ps(), base, idx, m, 4);
+}
+static inline vint vGatherInt(const int *base, vint idx, vmask m) {
+  return _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), base, idx,
+                                     _mm256_castps_si256(m), 4);
+}
+#endif
+
+static inline vfloat vDot(vfloat x1, vfloat y1, vfloat z1, vfloat x2,
+                          vfloat y2, vfloat z2) {
+  return vAdd(vAdd(vMul(x1, x2), vMul(y1, y2)), vMul(z1, z2));
+}
+
+// Clear the upper halves of the vector registers after a kernel
+// The compiler does not always do it when the vectors are passed to a
+// call, and scalar SSE code run afterwards, e.g. atan2f of libm, is then
+// several times slower.
+static inline void vEnd() { _mm256_zeroupper(); }
+#endif
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "sdf.h"
+
+#include <cstdint>
+#include <unordered_map>
+
+// # of leaves along each side of an internal node, as a power of 2
+#define SPARSE_NODE_LOG2 4
+#define SPARSE_NODE_SIZE (1 << SPARSE_NODE_LOG2)
+#define SPARSE_NODE_CHILDREN                                                  \
+  (SPARSE_NODE_SIZE * SPARSE_NODE_SIZE * SPARSE_NODE_SIZE)
+
+// # of cells along each side of an internal node, as a power of 2
+#define SPARSE_NODE_CELLS_LOG2 (SPARSE_NODE_LOG2 + BRICK_LOG2)
+
+// a root entry without an internal node
+#define SPARSE_TILE -1
+
+/* Sparse signed distance field */
+// [Museth,2013] A three level tree in the spirit of VDB:
+// - root: hash map from the index of an internal node to the node,
+//         or to a tile value if the whole node is in the far field
+// - internal node: SPARSE_NODE_SIZE^3 children,
+//                  each is a leaf or a tile value
+// - leaf: BRICK_SIZE^3 samples, same as a brick of the bricked Grid
+// Only leaves near the surface are allocated. Every other cell reads
+// the tile value above it, e.g. +background outside the mesh and
+// -background inside, and a cell outside the root reads background.
+// Queries follow Grid, so positions are in world space and cells
+// outside nOfCells return 9999.
+class SparseGrid {
+public:
+  /* Members */
+  vec3 origin;
+  float cellSize;
+  ivec3 nOfCells;   // bounds of the field, as in Grid
+  float background; // tile value of cells without a node
+
+  // root entries: internal node index, or SPARSE_TILE
+  typedef struct {
+    int node;
+    float tile;
+  } RootEntry;
+  unordered_map<uint64_t, RootEntry> root;
+
+  vector<ivec3> nodeIdxs;     // index of each internal node
+  vector<int> nodeChildren;   // leaf index, or -1 for a tile
+  vector<float> nodeTiles;    // tile value of each child
+  vector<ivec3> leafIdxs;     // index of each leaf, in bricks
+  vector<float> leafSamples;  // BRICK_CELLS samples per leaf
+
+  /* Member functions */
+  void init(vec3, float, ivec3, float);
+  int addNode(ivec3);
+  int addLeaf(ivec3);
+  void setRootTile(ivec3, float);
+  const float *findLeaf(ivec3, float &);
+  float getValue(ivec3);
+  void setValue(ivec3, float);
+  vec3 getPos(ivec3);
+  float getDistance(vec3);
+  float getDistanceGradient(vec3, vec3 &);
+  vec3 getGradient(vec3);
+  size_t getMemorySize();
+
+  /* Constructors */
+  SparseGrid() : origin(0), cellSize(0.1f), nOfCells(0), background(9999.f) {}
+  ~SparseGrid() {}
+};
+
+uint64_t sparseKey(ivec3);
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "sdf.h"
+#include "radixSort.h"
+
+/* Uniform grid of points, wrapped around into a table */
+// Cell c goes to bucket c mod 2^bits along each axis, x first, so the
+// grid is unbounded and neighbouring cells are in neighbouring buckets.
+// The table has about one bucket per point, or minBuckets of build().
+// build() sorts the points by bucket with radixSort() and records where
+// each bucket starts, as a counting sort would, so the points of a range
+// of buckets are contiguous. Their positions are copied in that order.
+// There are at least 4 buckets along each axis, so the 27 cells around
+// a cell are in 27 different buckets, and a point closer than cellSize
+// to a cell is found exactly once in the buckets of these cells.
+class SpatialHash {
+public:
+  /* Members */
+  float cellSize;
+  int tableBits;            // the table has 2^tableBits buckets
+  ivec3 bits;               // bits of the bucket along each axis
+  vector<uint32_t> keys;    // bucket of each sorted point
+  vector<int> order;        // index of each sorted point
+  vector<float> xs, ys, zs; // position of each sorted point
+  vector<int> starts;       // first sorted point of each bucket and above,
+                            // starts[2^tableBits] is the # of points
+
+  /* Member functions */
+  void build(const float *, const float *, const float *, int, float,
+             ThreadPool &, int minBuckets = 0);
+  ivec3 getCell(vec3 p) { return ivec3(floor(p / cellSize)); }
+  uint32_t getBucket(ivec3);
+
+  /* Constructors */
+  SpatialHash() : cellSize(1.f), tableBits(0), bits(0) {}
+  ~SpatialHash() {}
+};
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+using namespace std;
+
+/* Define a range of work */
+typedef struct {
+  int begin, end;
+} Task;
+
+/* A deque of tasks owned by one worker */
+// The owner pops from the back,
+// other workers steal from the front.
+class TaskQueue {
+public:
+  deque<Task> tasks;
+  mutex m;
+
+  void push(Task);
+  bool pop(Task &);
+  bool steal(Task &);
+};
+
+/* Work-stealing thread pool */
+// parallelFor() cuts [begin, end) into chunks of at least grain,
+// and the calling thread works as worker 0.
+class ThreadPool {
+public:
+  /* Member functions */
+  void parallelFor(int, int, int, const function<void(int, int)> &);
+  int size() { return nOfThreads; }
+
+  /* Constructors */
+  // nOfThreads <= 0 means one thread per hardware thread
+  ThreadPool(int nOfThreads = 0);
+  ~ThreadPool();
+
+private:
+  int nOfThreads;
+  vector<thread> workers;
+  vector<TaskQueue> queues; // queues[i] belongs to worker i
+
+  const function<void(int, int)> *job;
+  atomic<int> remaining; // # of tasks not finished yet
+
+  mutex m;
+  condition_variable cvStart, cvDone;
+  unsigned int generation; // increased by each parallelFor()
+  bool quit;
+
+  void workerLoop(int);
+  void runTasks(int);
+};
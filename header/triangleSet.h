@@ -0,0 +1,42 @@
+#pragma once
+
+#include "mesh.h"
+#include "sdf.h"
+#include "alignedAllocator.h"
+#include "simd.h"
+
+// # of triangles evaluated at once by distPoint2Triangles()
+#define TRI_LANES SIMD_LANES
+
+/* Triangles of a mesh in structure-of-arrays layout */
+// Built once per mesh. Edges, normals and the inverse squared lengths
+// are computed here, so a query only does the closest-feature arithmetic.
+// Arrays are cache line aligned and padded to a multiple of 16
+// with degenerate triangles.
+class TriangleSet {
+public:
+  /* Members */
+  int nOfTris;
+  FloatArray ax, ay, az;          // vertex A
+  FloatArray bx, by, bz;          // vertex B
+  FloatArray cx, cy, cz;          // vertex C
+  FloatArray abx, aby, abz;       // B - A
+  FloatArray acx, acy, acz;       // C - A
+  FloatArray nx, ny, nz;          // face normal, used for the sign
+  FloatArray abab, abac, acac;    // dot(AB, AB), dot(AB, AC), dot(AC, AC)
+  FloatArray invAbab, invAcac;    // 1 / |AB|^2, 1 / |AC|^2
+  FloatArray invBcbc;             // 1 / |BC|^2
+  FloatArray invArea2;            // 1 / |cross(AB, AC)|^2
+  vector<int> faceIdxs;           // triangle i is Mesh::faces[faceIdxs[i]]
+
+  /* Member functions */
+  void build(Mesh &);
+  void build(Mesh &, vector<int> &);
+
+  /* Constructors */
+  TriangleSet() : nOfTris(0) {}
+  ~TriangleSet() {}
+};
+
+float distPoint2Triangle(TriangleSet &, int, vec3);
+void distPoint2Triangles(TriangleSet &, int, int, vec3, float *);
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "bvh.h"
+
+/* Fast winding number of a mesh */
+// [Barill,2018] Each bvh node is summarized by a dipole
+// (area weighted normal at the area weighted center of its triangles).
+// A node far enough from the query point is evaluated by its dipole,
+// otherwise by its children, and a leaf by the exact solid angles.
+// Unlike the sign of the closest triangle, the winding number degrades
+// gracefully on meshes with holes, i.e. it stays close to 1 inside.
+class WindingNumber {
+public:
+  /* Members */
+  Bvh *bvh;
+  vector<vec3> centers;     // area weighted center of each node
+  vector<vec3> areaNormals; // sum of (area * normal) of each node
+  vector<float> radii;      // radius of a ball around center
+                            // which covers all triangles of the node
+  float beta; // use the dipole if dist > beta * radius
+
+  /* Member functions */
+  void build(Bvh &);
+  float getWinding(vec3);
+
+  /* Constructors */
+  WindingNumber() : bvh(NULL), beta(2.f) {}
+  ~WindingNumber() {}
+};
+
+float solidAngle(vec3, vec3, vec3);
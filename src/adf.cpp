@@ -0,0 +1,103 @@
+#include "adf.h"
+
+/* Member functions of Adf */
+// Return the leaf containing p, with its lower corner and side
+// Return -1 if p is outside the root cube.
+int Adf::findLeaf(vec3 p, vec3 &cellMin, float &cellSize) {
+  vec3 u = (p - origin) / size;
+
+  // written as "not inside" so that NaN is outside
+  if (nodes.empty() || !(u.x >= 0.f && u.x <= 1.f && u.y >= 0.f &&
+                         u.y <= 1.f && u.z >= 0.f && u.z <= 1.f)) {
+    return -1;
+  }
+
+  int node = 0;
+  cellMin = origin;
+  cellSize = size;
+
+  while (nodes[node].children >= 0) {
+    cellSize *= 0.5f;
+    vec3 center = cellMin + cellSize;
+
+    int c = 0;
+    if (p.x >= center.x) {
+      c |= 1;
+      cellMin.x = center.x;
+    }
+    if (p.y >= center.y) {
+      c |= 2;
+      cellMin.y = center.y;
+    }
+    if (p.z >= center.z) {
+      c |= 4;
+      cellMin.z = center.z;
+    }
+
+    node = nodes[node].children + c;
+  }
+
+  return node;
+}
+
+// Trilinear signed distance of the leaf containing p
+float Adf::getDistance(vec3 p) {
+  vec3 grad;
+
+  return getDistanceGradient(p, grad);
+}
+
+// Trilinear signed distance and its analytic gradient at p
+// Same as Grid::getDistanceGradient() on the leaf containing p.
+float Adf::getDistanceGradient(vec3 p, vec3 &grad) {
+  vec3 cellMin;
+  float cellSize;
+  int leaf = findLeaf(p, cellMin, cellSize);
+
+  if (leaf < 0) {
+    grad = vec3(0);
+    return 9999.f;
+  }
+
+  const float *d = nodes[leaf].d;
+  vec3 t = glm::clamp((p - cellMin) / cellSize, vec3(0), vec3(1));
+
+  // along x
+  float d00 = d[0] + t.x * (d[1] - d[0]);
+  float d10 = d[2] + t.x * (d[3] - d[2]);
+  float d01 = d[4] + t.x * (d[5] - d[4]);
+  float d11 = d[6] + t.x * (d[7] - d[6]);
+
+  // along y
+  float d0 = d00 + t.y * (d10 - d00);
+  float d1 = d01 + t.y * (d11 - d01);
+
+  // derivatives of the interpolant in cell space
+  float gx0 = (d[1] - d[0]) + t.y * ((d[3] - d[2]) - (d[1] - d[0]));
+  float gx1 = (d[5] - d[4]) + t.y * ((d[7] - d[6]) - (d[5] - d[4]));
+
+  grad.x = gx0 + t.z * (gx1 - gx0);
+  grad.y = (d10 - d00) + t.z * ((d11 - d01) - (d10 - d00));
+  grad.z = d1 - d0;
+  grad /= cellSize;
+
+  return d0 + t.z * (d1 - d0);
+}
+
+// Same as Grid::getGradient(), but from the analytic gradient
+vec3 Adf::getGradient(vec3 p) {
+  vec3 grad;
+  getDistanceGradient(p, grad);
+
+  return normalize(-grad);
+}
+
+int Adf::getNumLeaves() {
+  int nOfLeaves = 0;
+
+  for (size_t i = 0; i < nodes.size(); i++) {
+    nOfLeaves += (nodes[i].children < 0);
+  }
+
+  return nOfLeaves;
+}
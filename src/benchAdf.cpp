@@ -0,0 +1,166 @@
+#include "sdfGen.h"
+#include "sdfIO.h"
+
+#include <chrono>
+#include <cstdio>
+
+float randf();
+
+// Adaptive distance field of a mesh against the uniform grid of its
+// finest cells: generation time, memory, and the error from the exact
+// distance within the band, after a round trip of the adf through its
+// file
+// usage: benchAdf [mesh] [cell size] [tolerance] [band] [# of points]
+// Both are generated as createSdf -sign winding does.
+int main(int argc, char const *argv[]) {
+  string meshFile = (argc > 1) ? argv[1] : "./mesh/bunny.obj";
+  float cellSize = (argc > 2) ? atof(argv[2]) : 0.02f;
+  float tolerance = (argc > 3) ? atof(argv[3]) : 0.001f;
+  int band = (argc > 4) ? atoi(argv[4]) : 3;
+  int nOfPts = (argc > 5) ? atoi(argv[5]) : 200000;
+
+  ThreadPool pool(0);
+
+  Mesh mesh = loadObj(meshFile, pool);
+  findAABB(mesh);
+
+  Bvh bvh;
+  bvh.build(mesh);
+
+  WindingNumber wn;
+  wn.build(bvh);
+
+  // same range as createSdf
+  vec3 rangeOffset(0.2f);
+  vec3 origin = mesh.min - rangeOffset;
+  ivec3 n = ivec3(((mesh.max + rangeOffset) - origin) / cellSize);
+
+  /* uniform grid */
+  auto t0 = chrono::steady_clock::now();
+
+  Grid dense;
+  dense.init(origin, cellSize, n, 9999.f);
+
+  vector<char> inside;
+  computeInsideWinding(dense, wn, pool, inside);
+  generateSdfExact(dense, bvh, pool, ivec3(0), n, true);
+  applySign(dense, inside);
+
+  /* adf, a cube over the grid halved down to cellSize */
+  auto t1 = chrono::steady_clock::now();
+
+  int nMax = glm::max(glm::max(n.x, n.y), n.z);
+
+  Adf adf;
+  while ((1 << adf.maxDepth) < nMax) {
+    adf.maxDepth++;
+  }
+  adf.origin = origin;
+  adf.size = cellSize * (1 << adf.maxDepth);
+  adf.tolerance = tolerance;
+  adf.maxDistance = band * cellSize;
+  generateAdf(adf, bvh, &wn, pool);
+
+  auto t2 = chrono::steady_clock::now();
+
+  string adfFile = "benchAdf.adf";
+  writeAdf(adf, adfFile);
+
+  Adf loaded;
+  bool isRead = readAdf(loaded, adfFile);
+  remove(adfFile.c_str());
+
+  if (!isRead) {
+    cout << "cannot read " << adfFile << '\n';
+    return 1;
+  }
+
+  // the file stores the nodes as they are in memory
+  bool isSame = loaded.nodes.size() == adf.nodes.size() &&
+                memcmp(loaded.nodes.data(), adf.nodes.data(),
+                       adf.nodes.size() * sizeof(AdfNode)) == 0;
+
+  /* error from the exact distance */
+  // random points of the grid range within the band
+  srand(0);
+  float bandWidth = band * cellSize;
+  vec3 extent = vec3(n - 1) * cellSize;
+
+  vector<vec3> pts;
+  vector<float> exacts;
+
+  while (int(pts.size()) < nOfPts) {
+    vec3 p = origin + vec3(randf(), randf(), randf()) * extent;
+    float d = abs(bvh.getDistance(p));
+
+    if (d < bandWidth) {
+      pts.push_back(p);
+      exacts.push_back((wn.getWinding(p) > 0.5f) ? -d : d);
+    }
+  }
+
+  vector<float> denseDists(nOfPts), adfDists(nOfPts);
+  vector<vec3> denseGrads(nOfPts), adfGrads(nOfPts);
+
+  auto t3 = chrono::steady_clock::now();
+
+  for (int i = 0; i < nOfPts; i++) {
+    denseDists[i] = dense.getDistanceGradient(pts[i], denseGrads[i]);
+  }
+
+  auto t4 = chrono::steady_clock::now();
+
+  for (int i = 0; i < nOfPts; i++) {
+    adfDists[i] = loaded.getDistanceGradient(pts[i], adfGrads[i]);
+  }
+
+  auto t5 = chrono::steady_clock::now();
+
+  float denseMax = 0.f, adfMax = 0.f;
+  double denseSum = 0.0, adfSum = 0.0;
+  int nOfTripErrors = 0;
+
+  for (int i = 0; i < nOfPts; i++) {
+    float denseError = abs(denseDists[i] - exacts[i]);
+    float adfError = abs(adfDists[i] - exacts[i]);
+
+    denseMax = glm::max(denseMax, denseError);
+    adfMax = glm::max(adfMax, adfError);
+    denseSum += denseError;
+    adfSum += adfError;
+
+    // getDistance() is getDistanceGradient() without the gradient
+    nOfTripErrors += (adf.getDistance(pts[i]) != adfDists[i]);
+  }
+
+  double denseTime = chrono::duration<double>(t1 - t0).count();
+  double adfTime = chrono::duration<double>(t2 - t1).count();
+  double denseQueryTime = chrono::duration<double>(t4 - t3).count();
+  double adfQueryTime = chrono::duration<double>(t5 - t4).count();
+
+  cout << "threads: " << pool.size() << ", band: " << band
+       << " cells, tolerance: " << tolerance << '\n';
+  cout << "uniform: " << n.x << " x " << n.y << " x " << n.z << " cells, "
+       << dense.getStorageSize() / 1e6 << " MB, " << denseTime << " s"
+       << '\n';
+  cout << "adf:     " << adf.nodes.size() << " nodes, " << adf.getNumLeaves()
+       << " leaves, depth " << adf.maxDepth << ", "
+       << adf.nodes.size() * sizeof(AdfNode) / 1e6 << " MB, " << adfTime
+       << " s" << '\n';
+  cout << "round trip: " << (isSame ? "same nodes" : "DIFFERENT NODES")
+       << ", query mismatches: " << nOfTripErrors << '\n';
+  cout << "points in the band: " << nOfPts << '\n';
+  cout << "uniform error: max " << denseMax << ", mean " << denseSum / nOfPts
+       << ", " << nOfPts / denseQueryTime / 1e6 << " M queries/s" << '\n';
+  cout << "adf error:     max " << adfMax << ", mean " << adfSum / nOfPts
+       << ", " << nOfPts / adfQueryTime / 1e6 << " M queries/s" << '\n';
+
+  return 0;
+}
+
+float randf() {
+  // [0, 1]
+  float f = static_cast<float>(rand()) / static_cast<float>(RAND_MAX);
+
+  return f;
+}
@@ -0,0 +1,91 @@
+#include "particleSystem.h"
+
+#include <chrono>
+
+float randf();
+void randomBox(ParticleSystem &, int);
+int bruteForcePairs(ParticleSystem &);
+
+// Scaling of the particle contacts of ParticleSystem
+// usage: benchContacts [max # of particles] [# of threads]
+// From 10k particles, x10 up to the max. The density is the same for all
+// sizes, about 4 neighbours per particle, so the time should grow
+// linearly. At 10k particles the # of pairs is checked against O(N^2).
+int main(int argc, char const *argv[]) {
+  int maxN = (argc > 1) ? atoi(argv[1]) : 10000000;
+  int nOfThreads = (argc > 2) ? atoi(argv[2]) : 0;
+
+  ThreadPool pool(nOfThreads);
+
+  cout << "threads: " << pool.size() << '\n';
+  cout << "particles  hash (ms)  total (ms)  pairs  M particles/s"
+       << '\n';
+
+  for (int n = 10000; n <= maxN; n *= 10) {
+    ParticleSystem ps;
+    ps.contactRadius = 0.5f;
+
+    srand(0);
+    randomBox(ps, n);
+
+    auto t0 = chrono::steady_clock::now();
+
+    // the hash build is timed inside, see hashTime
+    int nOfPairs = ps.collideParticles(pool);
+
+    auto t1 = chrono::steady_clock::now();
+
+    double totalTime = chrono::duration<double>(t1 - t0).count();
+
+    cout << n << "  " << ps.hashTime * 1e3 << "  " << totalTime * 1e3 << "  "
+         << nOfPairs << "  " << n / totalTime / 1e6 << '\n';
+
+    // collideParticles() moved the particles, so start over
+    if (n == 10000) {
+      srand(0);
+      ps.clear();
+      randomBox(ps, n);
+
+      int nOfExpected = bruteForcePairs(ps);
+      cout << "brute force pairs: " << nOfExpected
+           << (nOfExpected == nOfPairs ? " (match)" : " (MISMATCH)") << '\n';
+    }
+  }
+
+  return 0;
+}
+
+// n particles at rest in a cube of volume n
+void randomBox(ParticleSystem &ps, int n) {
+  float side = cbrt(float(n));
+
+  for (int i = 0; i < n; i++) {
+    vec3 pos = vec3(randf(), randf(), randf()) * side;
+    ps.add(pos, vec3(0), 1.f);
+  }
+}
+
+// # of pairs closer than 2 * contactRadius, same test as the contacts
+int bruteForcePairs(ParticleSystem &ps) {
+  int n = ps.size();
+  float h = 2.f * ps.contactRadius;
+  int nOfPairs = 0;
+
+  for (int i = 0; i < n; i++) {
+    for (int j = i + 1; j < n; j++) {
+      vec3 d = ps.getPos(i) - ps.getPos(j);
+      float dist2 = dot(d, d);
+
+      nOfPairs += (dist2 < h * h && dist2 > 0.f);
+    }
+  }
+
+  return nOfPairs;
+}
+
+float randf() {
+  // [0, 1]
+  float f = static_cast<float>(rand()) / static_cast<float>(RAND_MAX);
+
+  return f;
+}
@@ -0,0 +1,175 @@
+#include "mesh.h"
+#include "sdf.h"
+#include "triangleSet.h"
+#include "bvh.h"
+
+#include <chrono>
+
+float randf();
+Mesh tiledPlane(int);
+int checkBvh(Mesh &, vector<vec3> &);
+
+// Microbenchmark of the point-to-triangle distance kernels
+// usage: benchDist [mesh] [# of query points]
+// Also checks the bvh against merging all the faces in order, on the mesh
+// and on a tiled plane whose coplanar triangles tie.
+int main(int argc, char const *argv[]) {
+  string meshFile = (argc > 1) ? argv[1] : "./mesh/bunny.obj";
+  int nOfPts = (argc > 2) ? atoi(argv[2]) : 500;
+
+  Mesh mesh = loadObj(meshFile);
+  findAABB(mesh);
+
+  TriangleSet ts;
+  ts.build(mesh);
+
+  int nOfTris = mesh.faces.size();
+
+  // query points around the mesh
+  srand(0);
+  vector<vec3> pts(nOfPts);
+  vec3 range = (mesh.max - mesh.min) * 1.5f;
+  for (int i = 0; i < nOfPts; i++) {
+    pts[i] = mesh.min - range / 6.f + vec3(randf(), randf(), randf()) * range;
+  }
+
+  vector<float> scalarDists(nOfTris), batchDists(nOfTris);
+  double scalarTime = 0, batchTime = 0;
+  float maxError = 0.f;
+  int nOfSignErrors = 0;
+
+  for (int i = 0; i < nOfPts; i++) {
+    vec3 P = pts[i];
+
+    // scalar: distPoint2Triangle() of each face
+    auto t0 = chrono::steady_clock::now();
+
+    for (int j = 0; j < nOfTris; j++) {
+      Face &face = mesh.faces[j];
+
+      scalarDists[j] = distPoint2Triangle(
+          mesh.vertices[face.v1], mesh.vertices[face.v2],
+          mesh.vertices[face.v3], mesh.faceNormals[face.vn1], P);
+    }
+
+    // batched: TRI_LANES triangles at once
+    auto t1 = chrono::steady_clock::now();
+
+    distPoint2Triangles(ts, 0, nOfTris, P, &batchDists[0]);
+
+    auto t2 = chrono::steady_clock::now();
+
+    scalarTime += chrono::duration<double>(t1 - t0).count();
+    batchTime += chrono::duration<double>(t2 - t1).count();
+
+    // the scalar version returns 9999 if no region is found
+    for (int j = 0; j < nOfTris; j++) {
+      if (abs(scalarDists[j]) > 9000.f) {
+        continue;
+      }
+
+      maxError = glm::max(maxError, abs(abs(scalarDists[j]) - abs(batchDists[j])));
+
+      if ((scalarDists[j] < 0) != (batchDists[j] < 0)) {
+        nOfSignErrors++;
+      }
+    }
+  }
+
+  double nOfPairs = double(nOfPts) * nOfTris;
+
+  cout << "triangles: " << nOfTris << ", points: " << nOfPts
+       << ", lanes: " << TRI_LANES << '\n';
+  cout << "scalar:  " << nOfPairs / scalarTime / 1e6 << " M tris/s" << '\n';
+  cout << "batched: " << nOfPairs / batchTime / 1e6 << " M tris/s" << '\n';
+  cout << "speedup: " << scalarTime / batchTime << "x" << '\n';
+  cout << "max |dist| error: " << maxError
+       << ", sign mismatches: " << nOfSignErrors << '\n';
+
+  cout << "bvh mismatches: " << checkBvh(mesh, pts) << '\n';
+
+  // seen from high above, the distances of the tiles differ by less than
+  // TIE_EPSILON from one tile to the next over most of the plane
+  Mesh plane = tiledPlane(100);
+  vector<vec3> planePts(nOfPts);
+  for (int i = 0; i < nOfPts; i++) {
+    planePts[i] = vec3(randf(), (randf() * 2.f - 1.f) * 10.f, randf());
+  }
+
+  cout << "bvh mismatches on a tiled plane: " << checkBvh(plane, planePts)
+       << '\n';
+
+  return 0;
+}
+
+// n x n squares of two triangles in [0, 1] x [0, 1] at y = 0, facing +y
+Mesh tiledPlane(int n) {
+  Mesh mesh;
+  float size = 1.f / n;
+
+  for (int j = 0; j <= n; j++) {
+    for (int i = 0; i <= n; i++) {
+      mesh.vertices.push_back(vec3(i * size, 0.f, j * size));
+    }
+  }
+  mesh.faceNormals.push_back(vec3(0.f, 1.f, 0.f));
+
+  for (int j = 0; j < n; j++) {
+    for (int i = 0; i < n; i++) {
+      unsigned int a = j * (n + 1) + i;
+      unsigned int b = a + n + 1;
+
+      Face f1 = {a, b, a + 1, MESH_NO_INDEX, MESH_NO_INDEX, MESH_NO_INDEX,
+                 0, 0, 0};
+      Face f2 = {a + 1, b, b + 1, MESH_NO_INDEX, MESH_NO_INDEX,
+                 MESH_NO_INDEX, 0, 0, 0};
+      mesh.faces.push_back(f1);
+      mesh.faces.push_back(f2);
+    }
+  }
+  findAABB(mesh);
+
+  return mesh;
+}
+
+// # of points where the bvh differs from merging all the faces in order,
+// queried alone and seeded by the previous point
+int checkBvh(Mesh &mesh, vector<vec3> &pts) {
+  TriangleSet ts;
+  ts.build(mesh);
+
+  Bvh bvh;
+  bvh.build(mesh);
+
+  int nOfTris = mesh.faces.size();
+  vector<float> dists(nOfTris);
+  int nOfMismatches = 0;
+  int closest = -1;
+  float lastDist = 9999.f;
+
+  for (size_t i = 0; i < pts.size(); i++) {
+    vec3 P = pts[i];
+
+    distPoint2Triangles(ts, 0, nOfTris, P, &dists[0]);
+
+    float dist = 9999.f;
+    for (int j = 0; j < nOfTris; j++) {
+      dist = mergeDistance(dist, dists[j]);
+    }
+
+    float bound = (i > 0) ? abs(lastDist) + length(P - pts[i - 1]) : 9999.f;
+    float seeded = bvh.getDistance(P, bound, closest);
+
+    nOfMismatches += (bvh.getDistance(P) != dist || seeded != dist);
+    lastDist = dist;
+  }
+
+  return nOfMismatches;
+}
+
+float randf() {
+  // [0, 1]
+  float f = static_cast<float>(rand()) / static_cast<float>(RAND_MAX);
+
+  return f;
+}
@@ -0,0 +1,138 @@
+#include "sdf.h"
+#include "simd.h"
+
+#include <chrono>
+
+float randf();
+void fillSphere(Grid &);
+float runQueries(Grid &, vector<vec3> &, vector<float> &, vector<vec3> &,
+                 double &, double &);
+
+// Microbenchmark of grid queries on the linear and the bricked layout
+// usage: benchGrid [# of cells per axis] [# of queries]
+int main(int argc, char const *argv[]) {
+  int n = (argc > 1) ? atoi(argv[1]) : 256;
+  int nOfQueries = (argc > 2) ? atoi(argv[2]) : 2000000;
+
+  Grid linear;
+  linear.init(vec3(0), 1.f / n, ivec3(n), 9999.f);
+  fillSphere(linear);
+
+  Grid bricked = linear;
+  bricked.setLayout(GRID_BRICKED);
+
+  srand(0);
+
+  // random: uniformly scattered, almost every query misses the cache
+  vector<vec3> randomPts(nOfQueries);
+  for (int i = 0; i < nOfQueries; i++) {
+    randomPts[i] = vec3(randf(), randf(), randf());
+  }
+
+  // coherent: a random walk of small steps, like a particle over time
+  vector<vec3> walkPts(nOfQueries);
+  vec3 p(0.5f);
+  for (int i = 0; i < nOfQueries; i++) {
+    vec3 step = vec3(randf(), randf(), randf()) - 0.5f;
+    p = glm::clamp(p + step * (2.f / n), vec3(0), vec3(1));
+    walkPts[i] = p;
+  }
+
+  vector<vec3> *patterns[2] = {&randomPts, &walkPts};
+  const char *patternNames[2] = {"random  ", "coherent"};
+
+  cout << "cells: " << n << "^3, queries: " << nOfQueries
+       << ", lanes: " << SIMD_LANES << '\n';
+  cout << "pattern   layout   scalar (M/s)  batched (M/s)" << '\n';
+
+  for (int t = 0; t < 2; t++) {
+    vector<vec3> &pts = *patterns[t];
+
+    vector<float> linDists, brkDists;
+    vector<vec3> linGrads, brkGrads;
+    double linScalar, linBatch, brkScalar, brkBatch;
+
+    float linError =
+        runQueries(linear, pts, linDists, linGrads, linScalar, linBatch);
+    float brkError =
+        runQueries(bricked, pts, brkDists, brkGrads, brkScalar, brkBatch);
+
+    // both layouts store the same samples,
+    // so the results must be identical
+    int nOfMismatches = 0;
+    for (int i = 0; i < nOfQueries; i++) {
+      if (linDists[i] != brkDists[i] || linGrads[i].x != brkGrads[i].x ||
+          linGrads[i].y != brkGrads[i].y || linGrads[i].z != brkGrads[i].z) {
+        nOfMismatches++;
+      }
+    }
+
+    cout << patternNames[t] << "  linear   " << nOfQueries / linScalar / 1e6
+         << "  " << nOfQueries / linBatch / 1e6 << '\n';
+    cout << patternNames[t] << "  bricked  " << nOfQueries / brkScalar / 1e6
+         << "  " << nOfQueries / brkBatch / 1e6 << '\n';
+    cout << "mismatches: " << nOfMismatches
+         << ", max scalar/batched error: " << glm::max(linError, brkError)
+         << '\n';
+  }
+
+  return 0;
+}
+
+// Signed distance of a sphere in the middle of the unit cube
+void fillSphere(Grid &grid) {
+  for (int k = 0; k < grid.nOfCells.z; k++) {
+    for (int j = 0; j < grid.nOfCells.y; j++) {
+      for (int i = 0; i < grid.nOfCells.x; i++) {
+        ivec3 idx(i, j, k);
+        vec3 pos = grid.getPos(idx);
+
+        grid.sd[grid.getOffset(idx)] = length(pos - vec3(0.5f)) - 0.3f;
+      }
+    }
+  }
+}
+
+// Query distance and gradient of every point,
+// one by one and then in batch
+// The batched results are returned in dists and grads,
+// the largest difference from the scalar ones is returned.
+float runQueries(Grid &grid, vector<vec3> &pts, vector<float> &dists,
+                 vector<vec3> &grads, double &scalarTime, double &batchTime) {
+  int nOfPts = pts.size();
+  vector<float> scalarDists(nOfPts);
+  vector<vec3> scalarGrads(nOfPts);
+  dists.resize(nOfPts);
+  grads.resize(nOfPts);
+
+  auto t0 = chrono::steady_clock::now();
+
+  for (int i = 0; i < nOfPts; i++) {
+    scalarDists[i] = grid.getDistanceGradient(pts[i], scalarGrads[i]);
+  }
+
+  auto t1 = chrono::steady_clock::now();
+
+  grid.getDistanceGradients(&pts[0], nOfPts, &dists[0], &grads[0]);
+
+  auto t2 = chrono::steady_clock::now();
+
+  scalarTime = chrono::duration<double>(t1 - t0).count();
+  batchTime = chrono::duration<double>(t2 - t1).count();
+
+  float maxError = 0.f;
+  for (int i = 0; i < nOfPts; i++) {
+    vec3 dg = abs(scalarGrads[i] - grads[i]);
+    maxError = glm::max(maxError, abs(scalarDists[i] - dists[i]));
+    maxError = glm::max(maxError, glm::max(dg.x, glm::max(dg.y, dg.z)));
+  }
+
+  return maxError;
+}
+
+float randf() {
+  // [0, 1]
+  float f = static_cast<float>(rand()) / static_cast<float>(RAND_MAX);
+
+  return f;
+}
@@ -0,0 +1,179 @@
+#include "sdfGen.h"
+#include "sdfIO.h"
+
+#include <chrono>
+#include <cstdio>
+
+float randf();
+
+// Round trip of the sparse grid of a mesh through its file,
+// checked against the dense grid of the same mesh
+// usage: benchSparse [mesh] [cell size] [band] [# of queries]
+// Cells within the band must read the dense value, cells without a leaf
+// the tile value of their side, +-band * cellSize. Both grids are
+// generated as createSdf -sign winding does, the sign of the closest
+// triangle is not the same over the cells of a tile.
+int main(int argc, char const *argv[]) {
+  string meshFile = (argc > 1) ? argv[1] : "./mesh/bunny.obj";
+  float cellSize = (argc > 2) ? atof(argv[2]) : 0.02f;
+  int band = (argc > 3) ? atoi(argv[3]) : 3;
+  int nOfQueries = (argc > 4) ? atoi(argv[4]) : 1000000;
+
+  ThreadPool pool(0);
+
+  Mesh mesh = loadObj(meshFile, pool);
+  findAABB(mesh);
+
+  Bvh bvh;
+  bvh.build(mesh);
+
+  WindingNumber wn;
+  wn.build(bvh);
+
+  // same range as createSdf
+  vec3 rangeOffset(0.2f);
+  vec3 origin = mesh.min - rangeOffset;
+  ivec3 n = ivec3(((mesh.max + rangeOffset) - origin) / cellSize);
+
+  Grid dense;
+  dense.init(origin, cellSize, n, 9999.f);
+
+  vector<char> inside;
+  computeInsideWinding(dense, wn, pool, inside);
+  generateSdfExact(dense, bvh, pool, ivec3(0), n, true);
+  applySign(dense, inside);
+
+  SparseGrid sparse;
+  sparse.init(origin, cellSize, n, 9999.f);
+  generateSdfSparse(sparse, bvh, &wn, pool, band);
+
+  string sparseFile = "benchSparse.sdf";
+  writeSparseSdf(sparse, sparseFile);
+
+  SparseGrid loaded;
+  bool isRead = isSparseSdf(sparseFile) && readSparseSdf(loaded, sparseFile);
+  remove(sparseFile.c_str());
+
+  if (!isRead) {
+    cout << "cannot read " << sparseFile << '\n';
+    return 1;
+  }
+
+  /* cells */
+  float bandWidth = band * cellSize;
+  int nOfBandCells = 0, nOfBandErrors = 0;
+  int nOfTileCells = 0, nOfTileErrors = 0;
+
+  for (int k = 0; k < n.z; k++) {
+    for (int j = 0; j < n.y; j++) {
+      for (int i = 0; i < n.x; i++) {
+        ivec3 idx(i, j, k);
+        float d = dense.getDistance(dense.getHash(idx));
+        float s = loaded.getValue(idx);
+
+        if (abs(d) <= bandWidth) {
+          nOfBandCells++;
+          nOfBandErrors += (s != d);
+        }
+
+        float tile;
+        if (!loaded.findLeaf(idx, tile)) {
+          nOfTileCells++;
+          nOfTileErrors += (s != ((d < 0.f) ? -bandWidth : bandWidth));
+        }
+      }
+    }
+  }
+
+  /* queries */
+  // points whose 8 corners are all within the band
+  srand(0);
+  vector<vec3> pts;
+  vec3 extent = vec3(n - 1) * cellSize;
+  float inner = bandWidth - cellSize * sqrt(3.f);
+
+  while (int(pts.size()) < nOfQueries) {
+    vec3 p = origin + vec3(randf(), randf(), randf()) * extent;
+
+    if (abs(dense.getDistance(p)) < inner) {
+      pts.push_back(p);
+    }
+  }
+
+  vector<float> denseDists(nOfQueries), sparseDists(nOfQueries);
+  vector<vec3> denseGrads(nOfQueries), sparseGrads(nOfQueries);
+
+  auto t0 = chrono::steady_clock::now();
+
+  for (int i = 0; i < nOfQueries; i++) {
+    denseDists[i] = dense.getDistanceGradient(pts[i], denseGrads[i]);
+  }
+
+  auto t1 = chrono::steady_clock::now();
+
+  for (int i = 0; i < nOfQueries; i++) {
+    sparseDists[i] = loaded.getDistanceGradient(pts[i], sparseGrads[i]);
+  }
+
+  auto t2 = chrono::steady_clock::now();
+
+  float maxError = 0.f, maxGradError = 0.f;
+  for (int i = 0; i < nOfQueries; i++) {
+    vec3 dg = abs(sparseGrads[i] - denseGrads[i]);
+
+    maxError = glm::max(maxError, abs(sparseDists[i] - denseDists[i]));
+    maxGradError = glm::max(maxGradError, glm::max(dg.x, glm::max(dg.y, dg.z)));
+  }
+
+  // getDistance() and getGradient() read cells without interpolation,
+  // the gradient is the same if the 6 cells it reads are in the band
+  int nOfCellErrors = 0, nOfGradPts = 0, nOfGradErrors = 0;
+  for (int i = 0; i < nOfQueries; i++) {
+    vec3 p = pts[i];
+
+    nOfCellErrors += (loaded.getDistance(p) != dense.getDistance(p));
+
+    bool isBand = true;
+    for (int a = 0; a < 6; a++) {
+      vec3 q = p;
+      q[a / 2] += (a & 1) ? cellSize : -cellSize;
+      isBand = isBand && abs(dense.getDistance(q)) <= bandWidth;
+    }
+
+    if (isBand) {
+      nOfGradPts++;
+      nOfGradErrors += (loaded.getGradient(p) != dense.getGradient(p));
+    }
+  }
+
+  double denseTime = chrono::duration<double>(t1 - t0).count();
+  double sparseTime = chrono::duration<double>(t2 - t1).count();
+
+  cout << "cells: " << n.x << " x " << n.y << " x " << n.z
+       << ", band: " << band << " cells" << '\n';
+  cout << "dense:  " << dense.getStorageSize() / 1e6 << " MB" << '\n';
+  cout << "sparse: " << loaded.getMemorySize() / 1e6 << " MB, "
+       << loaded.leafIdxs.size() << " leaves" << '\n';
+  cout << "band cells: " << nOfBandCells << ", mismatches: " << nOfBandErrors
+       << '\n';
+  cout << "tile cells: " << nOfTileCells << ", mismatches: " << nOfTileErrors
+       << '\n';
+  cout << "queries in the band: " << nOfQueries
+       << ", max |dist| error: " << maxError
+       << ", max gradient error: " << maxGradError
+       << ", cell mismatches: " << nOfCellErrors << '\n';
+  cout << "gradients in the band: " << nOfGradPts
+       << ", mismatches: " << nOfGradErrors << '\n';
+  cout << "dense: " << nOfQueries / denseTime / 1e6
+       << " M queries/s, sparse: " << nOfQueries / sparseTime / 1e6
+       << " M queries/s" << '\n';
+
+  return 0;
+}
+
+float randf() {
+  // [0, 1]
+  float f = static_cast<float>(rand()) / static_cast<float>(RAND_MAX);
+
+  return f;
+}
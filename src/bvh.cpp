@@ -0,0 +1,260 @@
+#include "bvh.h"
+
+#include <algorithm>
+#include <tuple>
+
+// max # of triangles in a leaf,
+// evaluated by one call of distPoint2Triangles(), so a full leaf
+// fills the lanes of the kernel
+#define BVH_LEAF_SIZE (TRI_LANES > 8 ? TRI_LANES : 8)
+
+// Ties are resolved by mergeDistance() in face order, and a positive
+// distance within TIE_EPSILON of the current one replaces it, so the
+// result can climb a chain of near-equal distances above the minimum.
+// Triangles within this margin of the closest one are collected first,
+// the margin grows if the chain reaches its end, see getDistance().
+#define BVH_TIE_MARGIN (2.f * TIE_EPSILON)
+
+// Distance between a point and an aabb
+// Return 0 if the point is inside the box
+float distPoint2Box(vec3 p, vec3 boxMin, vec3 boxMax) {
+  vec3 d = glm::max(glm::max(boxMin - p, vec3(0)), p - boxMax);
+
+  return length(d);
+}
+
+/* Member functions of Bvh */
+void Bvh::build(Mesh &m) {
+  int nOfTris = m.faces.size();
+
+  // aabb and centroid of each triangle
+  vector<vec3> triMin(nOfTris), triMax(nOfTris), centroids(nOfTris);
+
+  for (int i = 0; i < nOfTris; i++) {
+    Face &face = m.faces[i];
+
+    vec3 A = m.vertices[face.v1];
+    vec3 B = m.vertices[face.v2];
+    vec3 C = m.vertices[face.v3];
+
+    triMin[i] = glm::min(glm::min(A, B), C);
+    triMax[i] = glm::max(glm::max(A, B), C);
+    centroids[i] = (A + B + C) / 3.f;
+  }
+
+  triIdxs.resize(nOfTris);
+  for (int i = 0; i < nOfTris; i++) {
+    triIdxs[i] = i;
+  }
+
+  nodes.clear();
+  nodes.reserve(2 * (nOfTris / BVH_LEAF_SIZE + 1));
+
+  if (nOfTris > 0) {
+    buildNode(triMin, triMax, centroids, 0, nOfTris);
+  }
+
+  // a leaf is a contiguous range of the triangle set
+  tris.build(m, triIdxs);
+}
+
+// Build a node for triIdxs[first, last)
+// Return the index of the node
+int Bvh::buildNode(vector<vec3> &triMin, vector<vec3> &triMax,
+                   vector<vec3> &centroids, int first, int last) {
+  int nodeIdx = nodes.size();
+  nodes.push_back(BvhNode());
+
+  BvhNode node;
+  node.min = vec3(9999.f);
+  node.max = vec3(-9999.f);
+  node.left = node.right = -1;
+  node.first = first;
+  node.count = last - first;
+
+  vec3 cMin(9999.f), cMax(-9999.f); // aabb of centroids
+
+  for (int i = first; i < last; i++) {
+    int t = triIdxs[i];
+
+    node.min = glm::min(node.min, triMin[t]);
+    node.max = glm::max(node.max, triMax[t]);
+    cMin = glm::min(cMin, centroids[t]);
+    cMax = glm::max(cMax, centroids[t]);
+  }
+
+  if (node.count > BVH_LEAF_SIZE) {
+    // split at the median along the longest axis of centroids
+    vec3 extent = cMax - cMin;
+    int axis = 0;
+    if (extent.y > extent[axis]) {
+      axis = 1;
+    }
+    if (extent.z > extent[axis]) {
+      axis = 2;
+    }
+
+    int mid = (first + last) / 2;
+    std::nth_element(triIdxs.begin() + first, triIdxs.begin() + mid,
+                     triIdxs.begin() + last, [&](int a, int b) {
+                       return centroids[a][axis] < centroids[b][axis];
+                     });
+
+    // note: nodes may be reallocated in the recursion,
+    // so do not keep a reference to nodes[nodeIdx]
+    node.left = buildNode(triMin, triMax, centroids, first, mid);
+    node.right = buildNode(triMin, triMax, centroids, mid, last);
+  }
+
+  nodes[nodeIdx] = node;
+
+  return nodeIdx;
+}
+
+// Signed distance from p to the mesh
+// Give the same result as merging the distance
+// of all the faces in order with mergeDistance()
+float Bvh::getDistance(vec3 p) {
+  int closest = -1;
+
+  return getDistance(p, 9999.f, closest);
+}
+
+// Same as getDistance(p), seeded by what is known around p
+// bound: an upper bound of the unsigned distance, e.g. by the
+//        1-Lipschitz property |d(p)| <= |d(q)| + |p - q| of a neighbour q
+// closest: in, a triangle (index of tris) likely to be the closest,
+//          e.g. the one of a neighbour, or -1
+//          out, the closest triangle
+// Both only prune the search, so the result is exactly getDistance(p).
+float Bvh::getDistance(vec3 p, float bound, int &closest) {
+  float dist = 9999.f;
+
+  if (nodes.empty()) {
+    closest = -1;
+    return dist;
+  }
+
+  // the hint gives a tight bound before the traversal,
+  // it is found again there like any other triangle
+  if (closest >= 0 && closest < tris.nOfTris) {
+    bound = glm::min(bound, abs(distPoint2Triangle(tris, closest, p)));
+  }
+
+  // (face index, signed distance, index of tris)
+  // of triangles close to the bound, reused by the queries of a thread
+  static thread_local vector<tuple<int, float, int>> candidates;
+  static thread_local vector<float> absDists;
+
+  float margin = BVH_TIE_MARGIN;
+
+  // only ties can pull the result above the minimum, so every triangle
+  // of the chain of gaps below TIE_EPSILON from the minimum must be a
+  // candidate, and any triangle after a larger gap cannot change it
+  while (true) {
+    candidates.clear();
+
+    // the depth of a median-split tree is about log2(nOfTris)
+    int stack[64];
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0) {
+      BvhNode &node = nodes[stack[--top]];
+
+      if (distPoint2Box(p, node.min, node.max) > bound + margin) {
+        continue;
+      }
+
+      // leaf
+      if (node.left < 0) {
+        float dists[BVH_LEAF_SIZE];
+        distPoint2Triangles(tris, node.first, node.count, p, dists);
+
+        for (int i = 0; i < node.count; i++) {
+          float temp = dists[i];
+
+          if (abs(temp) <= bound + margin) {
+            int t = node.first + i;
+            candidates.push_back(make_tuple(triIdxs[t], temp, t));
+            bound = glm::min(bound, abs(temp));
+          }
+        }
+      }
+      // internal node: visit the closer child first
+      else {
+        BvhNode &l = nodes[node.left];
+        BvhNode &r = nodes[node.right];
+
+        float dl = distPoint2Box(p, l.min, l.max);
+        float dr = distPoint2Box(p, r.min, r.max);
+
+        if (dl < dr) {
+          stack[top++] = node.right;
+          stack[top++] = node.left;
+        } else {
+          stack[top++] = node.left;
+          stack[top++] = node.right;
+        }
+      }
+    } // end traverse
+
+    // the chain can only reach the margin through a candidate
+    // less than TIE_EPSILON below it, most queries have none
+    float edge = bound + margin;
+    bool nearEdge = false;
+
+    absDists.clear();
+    for (size_t i = 0; i < candidates.size(); i++) {
+      float a = abs(get<1>(candidates[i]));
+
+      if (a <= edge) {
+        absDists.push_back(a);
+        nearEdge = nearEdge || (a >= edge - TIE_EPSILON);
+      }
+    }
+
+    if (!nearEdge) {
+      break;
+    }
+
+    // end of the chain from the minimum
+    sort(absDists.begin(), absDists.end());
+
+    float chainEnd = bound;
+    for (size_t i = 1; i < absDists.size(); i++) {
+      if (absDists[i] - absDists[i - 1] > TIE_EPSILON) {
+        break;
+      }
+      chainEnd = absDists[i];
+    }
+
+    // done if all the triangles within TIE_EPSILON of the chain
+    // are collected, else traverse again with at least twice the margin
+    float reach = chainEnd + TIE_EPSILON - bound;
+    if (reach < margin) {
+      break;
+    }
+    margin = 2.f * reach;
+  }
+
+  // replay the brute-force merge on the candidates in face order
+  sort(candidates.begin(), candidates.end());
+
+  closest = -1;
+
+  for (size_t i = 0; i < candidates.size(); i++) {
+    float temp = get<1>(candidates[i]);
+
+    if (abs(temp) <= bound + margin) {
+      float merged = mergeDistance(dist, temp);
+
+      if (merged != dist || closest < 0) {
+        closest = get<2>(candidates[i]);
+      }
+      dist = merged;
+    }
+  }
+
+  return dist;
+}
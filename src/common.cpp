@@ -1,105 +1,5 @@
 #include "common.h"
 
-std::string readFile(const std::string filename) {
-  std::ifstream in;
-  in.open(filename.c_str());
-  std::stringstream ss;
-  ss << in.rdbuf();
-  std::string sOut = ss.str();
-  in.close();
-
-  return sOut;
-}
-
-Mesh loadObj(std::string filename) {
-  Mesh outMesh;
-
-  std::ifstream fin;
-  fin.open(filename.c_str());
-
-  if (!(fin.good())) {
-    std::cout << "failed to open file : " << filename << std::endl;
-  }
-
-  while (fin.peek() != EOF) { // read obj loop
-    std::string s;
-    fin >> s;
-
-    // vertex coordinate
-    if ("v" == s) {
-      float x, y, z;
-      fin >> x;
-      fin >> y;
-      fin >> z;
-      outMesh.vertices.push_back(glm::vec3(x, y, z));
-    }
-    // texture coordinate
-    else if ("vt" == s) {
-      float u, v;
-      fin >> u;
-      fin >> v;
-      outMesh.uvs.push_back(glm::vec2(u, v));
-    }
-    // face normal (recorded as vn in obj file)
-    else if ("vn" == s) {
-      float x, y, z;
-      fin >> x;
-      fin >> y;
-      fin >> z;
-      outMesh.faceNormals.push_back(glm::vec3(x, y, z));
-    }
-    // vertices contained in face, and face normal
-    else if ("f" == s) {
-      Face f;
-
-      // v1/vt1/vn1
-      fin >> f.v1;
-      fin.ignore(1);
-      fin >> f.vt1;
-      fin.ignore(1);
-      fin >> f.vn1;
-
-      // v2/vt2/vn2
-      fin >> f.v2;
-      fin.ignore(1);
-      fin >> f.vt2;
-      fin.ignore(1);
-      fin >> f.vn2;
-
-      // v3/vt3/vn3
-      fin >> f.v3;
-      fin.ignore(1);
-      fin >> f.vt3;
-      fin.ignore(1);
-      fin >> f.vn3;
-
-      // Note:
-      //  v, vt, vn in "v/vt/vn" start from 1,
-      //  but indices of std::vector start from 0,
-      //  so we need minus 1 for all elements
-      f.v1 -= 1;
-      f.vt1 -= 1;
-      f.vn1 -= 1;
-
-      f.v2 -= 1;
-      f.vt2 -= 1;
-      f.vn2 -= 1;
-
-      f.v3 -= 1;
-      f.vt3 -= 1;
-      f.vn3 -= 1;
-
-      outMesh.faces.push_back(f);
-    } else {
-      continue;
-    }
-  } // end read obj loop
-
-  fin.close();
-
-  return outMesh;
-}
-
 // return a shader executable
 GLuint buildShader(string vsDir, string fsDir) {
   GLuint vs, fs;
@@ -212,70 +112,6 @@ GLint myGetUniformLocation(GLuint &prog, std::string name) {
   return location;
 }
 
-/* Mesh class */
-void Mesh::translate(glm::vec3 xyz) {
-  // move each vertex with xyz
-  for (size_t i = 0; i < vertices.size(); i++) {
-    vertices[i] += xyz;
-  }
-
-  // update aabb
-  min += xyz;
-  max += xyz;
-}
-
-void Mesh::scale(glm::vec3 xyz) {
-  // scale each vertex with xyz
-  for (size_t i = 0; i < vertices.size(); i++) {
-    vertices[i].x *= xyz.x;
-    vertices[i].y *= xyz.y;
-    vertices[i].z *= xyz.z;
-  }
-
-  // update aabb
-  min.x *= xyz.x;
-  min.y *= xyz.y;
-  min.z *= xyz.z;
-
-  max.x *= xyz.x;
-  max.y *= xyz.y;
-  max.z *= xyz.z;
-}
-
-void findAABB(Mesh &mesh) {
-  int nOfVtxs = mesh.vertices.size();
-  glm::vec3 min(0, 0, 0), max(0, 0, 0);
-
-  for (size_t i = 0; i < nOfVtxs; i++) {
-    glm::vec3 vtx = mesh.vertices[i];
-
-    // x
-    if (vtx.x > max.x) {
-      max.x = vtx.x;
-    }
-    if (vtx.x < min.x) {
-      min.x = vtx.x;
-    }
-    // y
-    if (vtx.y > max.y) {
-      max.y = vtx.y;
-    }
-    if (vtx.y < min.y) {
-      min.y = vtx.y;
-    }
-    // z
-    if (vtx.z > max.z) {
-      max.z = vtx.z;
-    }
-    if (vtx.z < min.z) {
-      min.z = vtx.z;
-    }
-  }
-
-  mesh.min = min;
-  mesh.max = max;
-}
-
 void drawBox(glm::vec3 min, glm::vec3 max) {
   // 8 corners
   GLfloat aVtxs[] = {
@@ -528,6 +364,14 @@ void updateMesh(Mesh &mesh) {
   // delete[] aNormals;
 }
 
+// Delete the opengl buffers created by createMesh()
+void releaseMesh(Mesh &mesh) {
+  glDeleteBuffers(1, &mesh.vboVtxs);
+  glDeleteBuffers(1, &mesh.vboUvs);
+  glDeleteBuffers(1, &mesh.vboNormals);
+  glDeleteVertexArrays(1, &mesh.vao);
+}
+
 void drawPoints(std::vector<Point> &pts) { // array data
   int nOfPs = pts.size();
 
@@ -640,29 +484,28 @@ void drawTriangle(Triangle &tri) {
   glDeleteVertexArrays(1, &vao);
 }
 
-void drawPoints(Particles &ps) {
-  int nOfPs = ps.Ps.size();
+void drawPoints(Particles &ps, ParticleSystem &sys) {
+  int nOfPs = sys.size();
 
   // select vao
   glBindVertexArray(ps.vao);
 
+  // the vertex attribute is interleaved xyz,
+  // so the arrays of the particle system are packed first
+  ps.aPos.resize(size_t(nOfPs) * 3);
+  for (size_t i = 0; i < nOfPs; i++) {
+    ps.aPos[i * 3 + 0] = sys.px[i];
+    ps.aPos[i * 3 + 1] = sys.py[i];
+    ps.aPos[i * 3 + 2] = sys.pz[i];
+  }
+
   // position
   glBindBuffer(GL_ARRAY_BUFFER, ps.vboPos);
   // buffer orphaning
   glBufferData(GL_ARRAY_BUFFER, nOfPs * 3 * sizeof(GLfloat), NULL,
                GL_STREAM_DRAW);
-  for (size_t i = 0; i < nOfPs; i++) {
-    Point &p = ps.Ps[i];
-
-    glBufferSubData(GL_ARRAY_BUFFER, sizeof(GLfloat) * 3 * i,
-                    sizeof(GLfloat) * 3, &p.pos);
-
-    // if vec3 does not save data continuously in memory
-    // use the following code
-    // GLfloat temp[] = {p.pos.x, p.pos.y, p.pos.z};
-    // glBufferSubData(GL_ARRAY_BUFFER, sizeof(GLfloat) * 3 * i,
-    //                 sizeof(GLfloat) * 3, &temp);
-  }
+  glBufferSubData(GL_ARRAY_BUFFER, 0, nOfPs * 3 * sizeof(GLfloat),
+                  ps.aPos.data());
 
   // color
   // glBindBuffer(GL_ARRAY_BUFFER, ps.vboColor);
@@ -1,222 +1,353 @@
-#include "common.h"
 #include "sdf.h"
+#include "sdfGen.h"
+#include "sdfIO.h"
 
-GLFWwindow *window;
+#include <chrono>
 
 ivec3 nOfCells;
 float cellSize = 0.1f;
 vec3 gridOrigin(0, 0, 0);
 vec3 rangeOffset(0.2f, 0.2f, 0.2f);
 Grid grid;
+SparseGrid sparse; // used instead of grid by -sparse
+Adf adf;           // used instead of grid by -adf
 Mesh mesh;
+Bvh bvh;
+TriangleSet tris; // in the order of Mesh::faces
+WindingNumber wn;
+
+/* command line options */
+string meshFile = "./mesh/bunny.obj";
+string sdfFile = "sdf.txt";
+int nOfThreads = 0; // 0: one thread per hardware thread
+
+/* generation mode */
+int genMode = GEN_EXACT;
+int band = 3; // half width of the narrow band, in # of cells
+int coarseFactor = 4; // coarse cell of -coarse, in # of cells
+bool coherent = true; // seed each query by the previous cell, see -coherent
+int signMode = SIGN_NORMAL;
+int layout = GRID_LINEAR; // storage layout of the output
+int nOfLevels = 1;        // # of levels of the pyramid, see -levels
 
-void initGL();
-void initOther();
 void initGrid();
-void initMesh();
+void initMesh(ThreadPool &);
 
-void writeSdf(Grid &, const string);
-vec3 calCellPos(vec3);
-float randf();
+void generateSdf(ThreadPool &);
+void generateDistance(ThreadPool &);
+void writeLevels(ThreadPool &);
+void printUsage();
 
+// No window or OpenGL context is created,
+// so this runs on machines without a display.
 int main(int argc, char const *argv[]) {
-  initGL();
-  initOther();
-  initMesh();
-  initGrid();
-
-  /* find a searching range */
-  // select an area a little bigger than mesh's aabb
-  vec3 rangeMin = mesh.min - rangeOffset;
-  vec3 rangeMax = mesh.max + rangeOffset;
-
-  // find cells which cover those area
-  vec3 startCell = calCellPos(rangeMin);
-  vec3 endCell = calCellPos(rangeMax);
-
-  // for the selected range
-  for (float z = startCell.z; z < endCell.z; z += cellSize) {
-    for (float y = startCell.y; y < endCell.y; y += cellSize) {
-      for (float x = startCell.x; x < endCell.x; x += cellSize) {
-        vec3 P(x, y, z); // cell position
-        float dist = 9999.f;
-
-        // iterate triangles in the mesh
-        for (size_t i = 0; i < mesh.faces.size(); i++) {
-          Face face = mesh.faces[i];
-
-          glm::vec3 A, B, C, N;
-          A = mesh.vertices[face.v1];
-          B = mesh.vertices[face.v2];
-          C = mesh.vertices[face.v3];
-          N = mesh.faceNormals[face.vn1];
-
-          float temp = distPoint2Triangle(A, B, C, N, P);
-          float oldDist = dist;
-
-          // for general case
-          dist = (glm::abs(temp) < glm::abs(dist)) ? temp : dist;
-
-          // for a special case
-          float delta = abs(abs(temp) - abs(oldDist));
-          // if delta is less than some threshold
-          // we decide that temp is equal to dist
-          if (delta < 0.0001f) {
-
-            // if dist will change its sign
-            // we keep dist at the positive one
-            dist = (temp > 0) ? temp : oldDist;
-          }
-        } // end iterate triangles
-
-        // write dist into grid
-        int hash = calCellHash(P, nOfCells, cellSize);
-        grid.cells[hash].sd = dist;
-      } // end x direction
-    }   // end y direction
-  }     // end z direction
-
-  writeSdf(grid, "sdf.txt");
+  for (int i = 1; i < argc; i++) {
+    string opt = argv[i];
+
+    if (opt == "-h" || opt == "-help") {
+      printUsage();
+      return 0;
+    }
+
+    // every other option takes a value
+    if (i + 1 >= argc) {
+      cout << "missing value of " << opt << '\n';
+      printUsage();
+      return 1;
+    }
+    string val = argv[++i];
+
+    // with two generation modes, the result would depend on the order
+    bool isMode = (opt == "-narrowBand" || opt == "-sparse" ||
+                   opt == "-coarse" || opt == "-adf");
+    if (isMode && genMode != GEN_EXACT) {
+      cout << "only one of -narrowBand, -sparse, -coarse and -adf" << '\n';
+      printUsage();
+      return 1;
+    }
+
+    if (opt == "-mesh") {
+      meshFile = val;
+    } else if (opt == "-out") {
+      sdfFile = val;
+    } else if (opt == "-cellSize") {
+      cellSize = atof(val.c_str());
+    } else if (opt == "-offset") {
+      rangeOffset = vec3(atof(val.c_str()));
+    } else if (opt == "-threads") {
+      nOfThreads = atoi(val.c_str());
+    } else if (opt == "-narrowBand") {
+      genMode = GEN_NARROW_BAND;
+      band = atoi(val.c_str());
+    } else if (opt == "-sparse") {
+      genMode = GEN_SPARSE;
+      band = atoi(val.c_str());
+    } else if (opt == "-band") {
+      band = atoi(val.c_str());
+    } else if (opt == "-coarse") {
+      genMode = GEN_COARSE_TO_FINE;
+      coarseFactor = atoi(val.c_str());
+    } else if (opt == "-coherent") {
+      coherent = (val != "off");
+    } else if (opt == "-levels") {
+      nOfLevels = atoi(val.c_str());
+    } else if (opt == "-adf") {
+      genMode = GEN_ADF;
+      adf.tolerance = atof(val.c_str());
+    } else if (opt == "-sign") {
+      if (val == "parity") {
+        signMode = SIGN_PARITY;
+      } else if (val == "winding") {
+        signMode = SIGN_WINDING;
+      } else if (val == "normal") {
+        signMode = SIGN_NORMAL;
+      } else {
+        cout << "unknown sign mode " << val << '\n';
+        printUsage();
+        return 1;
+      }
+    } else if (opt == "-layout") {
+      layout = (val == "bricked") ? GRID_BRICKED : GRID_LINEAR;
+    } else {
+      cout << "unknown option " << opt << '\n';
+      printUsage();
+      return 1;
+    }
+  }
 
-  return 0;
-}
+  if (cellSize <= 0.f) {
+    cout << "cellSize must be positive" << '\n';
+    return 1;
+  }
 
-// calculate the position of the cell which covers the specified point
-vec3 calCellPos(vec3 pt) {
-  // change reference frame
-  vec3 ptRef = pt - gridOrigin;
+  // parity needs whole rows of cells
+  if ((genMode == GEN_SPARSE || genMode == GEN_ADF) &&
+      signMode == SIGN_PARITY) {
+    cout << "-sign parity needs a dense grid, use normal" << '\n';
+    signMode = SIGN_NORMAL;
+  }
 
-  // grid index along each axis of this cell
-  int ix = int(floor(ptRef.x / cellSize));
-  int iy = int(floor(ptRef.y / cellSize));
-  int iz = int(floor(ptRef.z / cellSize));
+  auto t0 = chrono::steady_clock::now();
 
-  // position of this cell
-  vec3 posRef = vec3(ix * cellSize, iy * cellSize, iz * cellSize);
+  ThreadPool pool(nOfThreads);
 
-  // change reference frame
-  vec3 pos = posRef + gridOrigin;
+  initMesh(pool);
+  if (mesh.faces.empty()) {
+    cout << "no faces in " << meshFile << '\n';
+    return 1;
+  }
+  initGrid();
 
-  return pos;
-}
+  generateSdf(pool);
 
-void initGrid() {
-  /* grid parameters */
-  // The grid covers the area of mesh
-  // Between the grid and the mesh,
-  // there is a offset area which is defined by rangeOffset
-  vec3 gridSize = (mesh.max + rangeOffset) - gridOrigin;
-  nOfCells = ivec3(gridSize / cellSize);
+  if (genMode == GEN_SPARSE) {
+    writeSparseSdf(sparse, sdfFile);
+  } else if (genMode == GEN_ADF) {
+    writeAdf(adf, sdfFile);
+  } else {
+    // generated in the linear layout, converted once at the end
+    grid.setLayout(layout);
 
-  grid.origin = gridOrigin;
-  grid.cellSize = cellSize;
-  grid.nOfCells = nOfCells;
+    if (isBinarySdf(sdfFile)) {
+      writeSdfBinary(grid, sdfFile);
+    } else {
+      writeSdf(grid, sdfFile);
+    }
 
-  // ATTENTION: the order of iterating x, y, z relates to
-  // the hash of cell index
-  for (size_t iz = 0; iz < nOfCells.z; iz++) {
-    for (size_t iy = 0; iy < nOfCells.y; iy++) {
-      for (size_t ix = 0; ix < nOfCells.x; ix++) {
-        Cell cell;
+    writeLevels(pool);
+  }
 
-        cell.idx = ivec3(ix, iy, iz);
-        cell.sd = 9999.f;
+  auto t1 = chrono::steady_clock::now();
+  double sec = chrono::duration<double>(t1 - t0).count();
+  cout << sdfFile << ": " << nOfCells.x << " x " << nOfCells.y << " x "
+       << nOfCells.z << " cells, " << mesh.faces.size() << " faces, "
+       << pool.size() << " threads, " << sec << " s" << '\n';
 
-        cell.pos = vec3(ix, iy, iz) * cellSize + gridOrigin;
+  if (genMode == GEN_SPARSE) {
+    cout << sparse.nodeIdxs.size() << " nodes, " << sparse.leafIdxs.size()
+         << " leaves, " << sparse.getMemorySize() / 1e6 << " MB" << '\n';
+  }
+  if (genMode == GEN_ADF) {
+    cout << adf.nodes.size() << " nodes, " << adf.getNumLeaves()
+         << " leaves, depth " << adf.maxDepth << ", "
+         << adf.nodes.size() * sizeof(AdfNode) / 1e6 << " MB" << '\n';
+  }
 
-        grid.cells.push_back(cell);
-      } // end of iterate x
-    }   // end of iterate y
-  }     // end of iterate z
+  return 0;
 }
 
-// format: x, y, z, i, j, k, dist
-void writeSdf(Grid &gd, const string fileName) {
-  ofstream output(fileName);
-
-  for (size_t i = 0; i < gd.cells.size(); i++) {
-    Cell &cell = gd.cells[i];
-
-    output << cell.pos.x;
-    output << " ";
-    output << cell.pos.y;
-    output << " ";
-    output << cell.pos.z;
-    output << " ";
-    output << cell.idx.x;
-    output << " ";
-    output << cell.idx.y;
-    output << " ";
-    output << cell.idx.z;
-    output << " ";
-    output << cell.sd;
-    output << '\n';
-  }
-
-  output.close();
+void printUsage() {
+  cout << "usage: createSdf [options]" << '\n'
+       << "  -mesh <file.obj>    input mesh (./mesh/bunny.obj)" << '\n'
+       << "  -out <file>         output sdf, binary if *.sdf (sdf.txt)"
+       << '\n'
+       << "  -cellSize <size>    cell size (0.1)" << '\n'
+       << "  -offset <dist>      margin around the mesh (0.2)" << '\n'
+       << "  -threads <n>        # of threads, 0 for all (0)" << '\n'
+       << "  -narrowBand <k>     exact within k cells, sweep elsewhere"
+       << '\n'
+       << "  -sparse <k>         sparse grid, exact within k cells,"
+       << '\n'
+       << "                      written in the sparse binary format" << '\n'
+       << "  -coherent on|off    seed each exact query by the previous cell"
+       << " (on)" << '\n'
+       << "  -coarse <k>         exact near the surface only, from a grid"
+       << '\n'
+       << "                      of k * cellSize, interpolated elsewhere"
+       << '\n'
+       << "  -adf <tolerance>    octree refined down to cellSize where"
+       << '\n'
+       << "                      the interpolation error > tolerance,"
+       << '\n'
+       << "                      within -band cells of the mesh" << '\n'
+       << "  -band <k>           half width of -adf in # of cells (3),"
+       << '\n'
+       << "                      same as k of -narrowBand and -sparse" << '\n'
+       << "  -sign normal|parity|winding" << '\n'
+       << "  -layout linear|bricked   storage layout (linear)" << '\n'
+       << "  -levels <n>         also write n - 1 coarse levels,"
+       << '\n'
+       << "                      e.g. sdf.1.txt with 2 * cellSize (1)"
+       << '\n';
 }
 
-void initMesh() {
-  /* prepare mesh data */
-  mesh = loadObj("./mesh/bunny.obj");
-  findAABB(mesh);
+// Write the coarse levels of the pyramid next to the output
+void writeLevels(ThreadPool &pool) {
+  if (nOfLevels <= 1) {
+    return;
+  }
 
-  // transform mesh to (origin + offset) position
-  vec3 offset = (gridOrigin - mesh.min) + rangeOffset;
-  mesh.translate(offset);
-}
+  SdfPyramid pyramid;
+  pyramid.build(grid, nOfLevels, pool);
+
+  for (int l = 1; l < pyramid.getNumLevels(); l++) {
+    Grid &level = pyramid.getGrid(l);
+    string levelFile = sdfLevelName(sdfFile, l);
 
-void initOther() { srand(clock()); }
+    level.setLayout(layout);
 
-float randf() {
-  // random number in [0, 1]
-  float f = static_cast<float>(rand()) / static_cast<float>(RAND_MAX);
+    if (isBinarySdf(sdfFile)) {
+      writeSdfBinary(level, levelFile);
+    } else {
+      writeSdf(level, levelFile);
+    }
 
-  return f;
+    cout << levelFile << ": " << level.nOfCells.x << " x " << level.nOfCells.y
+         << " x " << level.nOfCells.z << " cells, error bound "
+         << pyramid.getErrorBound(l) << '\n';
+  }
 }
 
-void initGL() { // Initialise GLFW
-  if (!glfwInit()) {
-    fprintf(stderr, "Failed to initialize GLFW\n");
-    getchar();
-    exit(EXIT_FAILURE);
+// Compute the signed distance of cells around the mesh
+void generateSdf(ThreadPool &pool) {
+  // the dense grid is never allocated
+  if (genMode == GEN_SPARSE) {
+    WindingNumber *signWn = (signMode == SIGN_WINDING) ? &wn : NULL;
+    generateSdfSparse(sparse, bvh, signWn, pool, band);
+    return;
+  }
+  if (genMode == GEN_ADF) {
+    WindingNumber *signWn = (signMode == SIGN_WINDING) ? &wn : NULL;
+    generateAdf(adf, bvh, signWn, pool);
+    return;
   }
 
-  // without setting GLFW_CONTEXT_VERSION_MAJOR and _MINOR，
-  // OpenGL 1.x will be used
-  glfwWindowHint(GLFW_SAMPLES, 4);
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+  // the sign does not depend on distances
+  // so it overrides the sign of the closest triangle,
+  // coarse to fine evaluates the winding number on its own nodes only
+  bool denseWinding =
+      (signMode == SIGN_WINDING && genMode != GEN_COARSE_TO_FINE);
+  if (signMode == SIGN_PARITY || denseWinding) {
+    vector<char> inside;
+
+    if (signMode == SIGN_PARITY) {
+      computeInsideParity(grid, tris, pool, inside);
+    } else {
+      computeInsideWinding(grid, wn, pool, inside);
+    }
+
+    generateDistance(pool);
+    applySign(grid, inside);
+  } else {
+    generateDistance(pool);
+  }
+}
 
-  // must be used if OpenGL version >= 3.0
-  glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+void generateDistance(ThreadPool &pool) {
+  if (genMode == GEN_NARROW_BAND) {
+    generateSdfNarrowBand(grid, tris, pool, band);
+    return;
+  }
+  if (genMode == GEN_COARSE_TO_FINE) {
+    WindingNumber *signWn = (signMode == SIGN_WINDING) ? &wn : NULL;
+    generateSdfCoarseToFine(grid, bvh, signWn, pool, coarseFactor);
+    return;
+  }
 
-  // Open a window and create its OpenGL context
-  window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "With normal mapping",
-                            NULL, NULL);
+  /* find a searching range */
+  // select an area a little bigger than mesh's aabb
+  vec3 rangeMin = mesh.min - rangeOffset;
+  vec3 rangeMax = mesh.max + rangeOffset;
 
-  if (window == NULL) {
-    std::cout << "Failed to open GLFW window." << std::endl;
-    glfwTerminate();
-    exit(EXIT_FAILURE);
-  }
+  // find cells which cover those area
+  ivec3 startIdx = ivec3(floor((rangeMin - gridOrigin) / cellSize));
+  ivec3 endIdx = ivec3(floor((rangeMax - gridOrigin) / cellSize));
+  startIdx = glm::clamp(startIdx, ivec3(0), nOfCells);
+  endIdx = glm::clamp(endIdx, ivec3(0), nOfCells);
 
-  glfwMakeContextCurrent(window);
-  // glfwSetKeyCallback(window, keyCallback);
-  // glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+  generateSdfExact(grid, bvh, pool, startIdx, endIdx, coherent);
+}
 
-  /* Initialize GLEW */
-  // without this, glGenVertexArrays will report ERROR!
-  glewExperimental = GL_TRUE;
+void initGrid() {
+  /* grid parameters */
+  // The grid covers the area of mesh
+  // Between the grid and the mesh,
+  // there is a offset area which is defined by rangeOffset
+  vec3 gridSize = (mesh.max + rangeOffset) - gridOrigin;
+  nOfCells = ivec3(gridSize / cellSize);
 
-  if (glewInit() != GLEW_OK) {
-    fprintf(stderr, "Failed to initialize GLEW\n");
-    getchar();
-    glfwTerminate();
-    exit(EXIT_FAILURE);
+  if (genMode == GEN_SPARSE) {
+    sparse.init(gridOrigin, cellSize, nOfCells, 9999.f);
+    return;
   }
 
-  glEnable(GL_CULL_FACE);
-  glEnable(GL_DEPTH_TEST); // must enable depth test!!
+  // a cube over the grid, halved until the cells reach cellSize
+  if (genMode == GEN_ADF) {
+    int nMax = glm::max(glm::max(nOfCells.x, nOfCells.y), nOfCells.z);
+
+    adf.maxDepth = 0;
+    while ((1 << adf.maxDepth) < nMax) {
+      adf.maxDepth++;
+    }
+    adf.origin = gridOrigin;
+    adf.size = cellSize * (1 << adf.maxDepth);
+    adf.maxDistance = band * cellSize;
+    return;
+  }
+
+  // all cells are allocated at once,
+  // the position of a cell is derived from its hash
+  grid.init(gridOrigin, cellSize, nOfCells, 9999.f);
+}
+
+void initMesh(ThreadPool &pool) {
+  /* prepare mesh data */
+  // parsed in parallel, or read from the binary cache of the mesh
+  mesh = loadObj(meshFile, pool);
+  findAABB(mesh);
+
+  // the mesh stays in the frame of the obj file, like SDFGen,
+  // and the grid starts rangeOffset below it
+  gridOrigin = mesh.min - rangeOffset;
+
+  if (genMode == GEN_NARROW_BAND || signMode == SIGN_PARITY) {
+    tris.build(mesh);
+  }
+  if (genMode == GEN_EXACT || genMode == GEN_SPARSE || genMode == GEN_ADF ||
+      genMode == GEN_COARSE_TO_FINE || signMode == SIGN_WINDING) {
+    bvh.build(mesh);
+  }
+  if (signMode == SIGN_WINDING) {
+    wn.build(bvh);
+  }
 }
@@ -0,0 +1,187 @@
+#include "sdf.h"
+#include "simd.h"
+
+// positions are read as packed xyz triples
+static_assert(sizeof(vec3) == 3 * sizeof(float), "vec3 must be packed");
+
+#if SIMD_LANES > 1
+// Grid::getOffset() of SIMD_LANES cells in the bricked layout
+static inline vint offsetLanes(Grid &grid, vint ix, vint iy, vint iz,
+                               vmask m) {
+  ivec3 nb = grid.nOfBricks;
+
+  vint brick = vAddInt(vShrInt(ix, BRICK_LOG2),
+                       vMulInt(vShrInt(iy, BRICK_LOG2), vSetInt(nb.x)));
+  brick = vAddInt(brick,
+                  vMulInt(vShrInt(iz, BRICK_LOG2), vSetInt(nb.x * nb.y)));
+
+  vint local = vAndInt(ix, BRICK_SIZE - 1);
+  local = vAddInt(local, vShlInt(vAndInt(iy, BRICK_SIZE - 1), BRICK_LOG2));
+  local =
+      vAddInt(local, vShlInt(vAndInt(iz, BRICK_SIZE - 1), 2 * BRICK_LOG2));
+
+  return vAddInt(vGatherInt(grid.brickOffsets.data(), brick, m), local);
+}
+
+// getDistanceGradient() of SIMD_LANES points
+// Indices are computed in vector registers and the corner samples are
+// loaded with gathers. Lanes outside the grid are masked off,
+// so they load nothing and get 9999 and a zero gradient.
+static void queryLanes(Grid &grid, vfloat px, vfloat py, vfloat pz,
+                       float *dists, float *gx, float *gy, float *gz) {
+  ivec3 n = grid.nOfCells;
+  // divide as the scalar query does, so both pick the same cell
+  vfloat h = vSet(grid.cellSize);
+
+  // grid space
+  vfloat ux = vDiv(vSub(px, vSet(grid.origin.x)), h);
+  vfloat uy = vDiv(vSub(py, vSet(grid.origin.y)), h);
+  vfloat uz = vDiv(vSub(pz, vSet(grid.origin.z)), h);
+
+  vfloat zero = vSet(0.f);
+  vfloat one = vSet(1.f);
+
+  // same bounds as getDistanceGradient(), NaN lanes are out too
+  vmask in = vAnd(vAnd(vLe(zero, ux), vLt(ux, vSet(n.x))),
+                  vAnd(vLe(zero, uy), vLt(uy, vSet(n.y))));
+  in = vAnd(in, vAnd(vLe(zero, uz), vLt(uz, vSet(n.z))));
+
+  // out of range lanes may overflow the conversion,
+  // but they are masked off below
+  vint izero = vSetInt(0);
+  vint ix0 = vMaxInt(vMinInt(vToInt(vFloor(ux)), vSetInt(n.x - 2)), izero);
+  vint iy0 = vMaxInt(vMinInt(vToInt(vFloor(uy)), vSetInt(n.y - 2)), izero);
+  vint iz0 = vMaxInt(vMinInt(vToInt(vFloor(uz)), vSetInt(n.z - 2)), izero);
+
+  vint ix1 = vMinInt(vAddInt(ix0, vSetInt(1)), vSetInt(n.x - 1));
+  vint iy1 = vMinInt(vAddInt(iy0, vSetInt(1)), vSetInt(n.y - 1));
+  vint iz1 = vMinInt(vAddInt(iz0, vSetInt(1)), vSetInt(n.z - 1));
+
+  vfloat tx = vMin(vMax(vSub(ux, vToFloat(ix0)), zero), one);
+  vfloat ty = vMin(vMax(vSub(uy, vToFloat(iy0)), zero), one);
+  vfloat tz = vMin(vMax(vSub(uz, vToFloat(iz0)), zero), one);
+
+  // where the 8 corners are stored
+  vint o[8];
+  vint ixs[2] = {ix0, ix1}, iys[2] = {iy0, iy1}, izs[2] = {iz0, iz1};
+
+  if (grid.layout == GRID_LINEAR) {
+    vint nx = vSetInt(n.x);
+    vint nxy = vSetInt(n.x * n.y);
+
+    for (int c = 0; c < 8; c++) {
+      vint yz = vAddInt(vMulInt(iys[(c >> 1) & 1], nx),
+                        vMulInt(izs[c >> 2], nxy));
+      o[c] = vAddInt(ixs[c & 1], yz);
+    }
+  } else {
+    for (int c = 0; c < 8; c++) {
+      o[c] = offsetLanes(grid, ixs[c & 1], iys[(c >> 1) & 1], izs[c >> 2], in);
+    }
+  }
+
+  const float *s = grid.samples;
+  vfloat d000 = vGather(s, o[0], in);
+  vfloat d100 = vGather(s, o[1], in);
+  vfloat d010 = vGather(s, o[2], in);
+  vfloat d110 = vGather(s, o[3], in);
+  vfloat d001 = vGather(s, o[4], in);
+  vfloat d101 = vGather(s, o[5], in);
+  vfloat d011 = vGather(s, o[6], in);
+  vfloat d111 = vGather(s, o[7], in);
+
+  // along x
+  vfloat e00 = vSub(d100, d000), e10 = vSub(d110, d010);
+  vfloat e01 = vSub(d101, d001), e11 = vSub(d111, d011);
+  vfloat d00 = vAdd(d000, vMul(tx, e00));
+  vfloat d10 = vAdd(d010, vMul(tx, e10));
+  vfloat d01 = vAdd(d001, vMul(tx, e01));
+  vfloat d11 = vAdd(d011, vMul(tx, e11));
+
+  // along y
+  vfloat f0 = vSub(d10, d00), f1 = vSub(d11, d01);
+  vfloat d0 = vAdd(d00, vMul(ty, f0));
+  vfloat d1 = vAdd(d01, vMul(ty, f1));
+
+  // derivatives, same as getDistanceGradient()
+  vfloat gx0 = vAdd(e00, vMul(ty, vSub(e10, e00)));
+  vfloat gx1 = vAdd(e01, vMul(ty, vSub(e11, e01)));
+
+  vfloat dist = vAdd(d0, vMul(tz, vSub(d1, d0)));
+  vfloat dx = vDiv(vAdd(gx0, vMul(tz, vSub(gx1, gx0))), h);
+  vfloat dy = vDiv(vAdd(f0, vMul(tz, vSub(f1, f0))), h);
+  vfloat dz = vDiv(vSub(d1, d0), h);
+
+  vStore(dists, vSelect(in, dist, vSet(9999.f)));
+  vStore(gx, vSelect(in, dx, zero));
+  vStore(gy, vSelect(in, dy, zero));
+  vStore(gz, vSelect(in, dz, zero));
+}
+#endif
+
+/* Member functions of Grid */
+// getDistanceGradient() of count points
+// dists: count floats, grads: count vec3 or NULL if not needed
+// The result is the same as the scalar query up to rounding.
+void Grid::getDistanceGradients(const vec3 *ps, int count, float *dists,
+                                vec3 *grads) {
+  int i = 0;
+
+#if SIMD_LANES > 1
+  float gx[SIMD_LANES], gy[SIMD_LANES], gz[SIMD_LANES];
+
+  // deinterleave xyz
+  vint stride = vMulInt(vLaneIdx(), vSetInt(3));
+
+  for (; i + SIMD_LANES <= count; i += SIMD_LANES) {
+    const float *p = &ps[i].x;
+    queryLanes(*this, vGather(p, stride), vGather(p + 1, stride),
+               vGather(p + 2, stride), &dists[i], gx, gy, gz);
+
+    if (grads != NULL) {
+      for (int k = 0; k < SIMD_LANES; k++) {
+        grads[i + k] = vec3(gx[k], gy[k], gz[k]);
+      }
+    }
+  }
+
+  vEnd();
+#endif
+
+  // tail
+  for (; i < count; i++) {
+    vec3 grad;
+    dists[i] = getDistanceGradient(ps[i], grad);
+
+    if (grads != NULL) {
+      grads[i] = grad;
+    }
+  }
+}
+
+// Same as above, for positions and gradients stored as separate arrays
+// Lanes are plain loads and stores, no deinterleaving.
+void Grid::getDistanceGradients(const float *xs, const float *ys,
+                                const float *zs, int count, float *dists,
+                                float *gxs, float *gys, float *gzs) {
+  int i = 0;
+
+#if SIMD_LANES > 1
+  for (; i + SIMD_LANES <= count; i += SIMD_LANES) {
+    queryLanes(*this, vLoad(&xs[i]), vLoad(&ys[i]), vLoad(&zs[i]), &dists[i],
+               &gxs[i], &gys[i], &gzs[i]);
+  }
+
+  vEnd();
+#endif
+
+  // tail
+  for (; i < count; i++) {
+    vec3 grad;
+    dists[i] = getDistanceGradient(vec3(xs[i], ys[i], zs[i]), grad);
+
+    gxs[i] = grad.x;
+    gys[i] = grad.y;
+    gzs[i] = grad.z;
+  }
+}
@@ -0,0 +1,80 @@
+#include "mappedFile.h"
+
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Map the whole file
+// Return false if the file cannot be opened or mapped
+bool MappedFile::open(const string fileName) {
+  close();
+
+  int fd = ::open(fileName.c_str(), O_RDONLY);
+
+  if (fd < 0) {
+    cout << "failed to open file : " << fileName << std::endl;
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    ::close(fd);
+    return false;
+  }
+
+  size = st.st_size;
+
+  // an empty file cannot be mapped, but it is still a valid file
+  if (size > 0) {
+    void *addr = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    if (addr == MAP_FAILED) {
+      cout << "failed to map file : " << fileName << std::endl;
+      ::close(fd);
+      size = 0;
+      return false;
+    }
+
+    data = static_cast<const char *>(addr);
+  }
+
+  // the mapping stays valid after closing the descriptor
+  ::close(fd);
+
+  return true;
+}
+
+void MappedFile::close() {
+  if (data != NULL) {
+    munmap(const_cast<char *>(data), size);
+  }
+
+  data = NULL;
+  size = 0;
+}
+
+// Cut the text [begin, end) into about nOfChunks pieces at line boundaries
+// bounds[c] and bounds[c + 1] are the range of chunk c,
+// a chunk other than the first starts at a '\n'.
+void splitLines(const char *begin, const char *end, int nOfChunks,
+                vector<const char *> &bounds) {
+  size_t length = end - begin;
+
+  bounds.resize(nOfChunks + 1);
+  bounds[0] = begin;
+  bounds[nOfChunks] = end;
+
+  for (int c = 1; c < nOfChunks; c++) {
+    const char *q = begin + length * c / nOfChunks;
+    if (q < bounds[c - 1]) {
+      q = bounds[c - 1];
+    }
+
+    while (q < end && *q != '\n') {
+      q++;
+    }
+    bounds[c] = q;
+  }
+}
@@ -0,0 +1,493 @@
+#include "mesh.h"
+
+#include <charconv>
+#include <cstring>
+#include <sys/stat.h>
+
+std::string readFile(const std::string filename) {
+  std::ifstream in;
+  in.open(filename.c_str());
+  std::stringstream ss;
+  ss << in.rdbuf();
+  std::string sOut = ss.str();
+  in.close();
+
+  return sOut;
+}
+
+/* OBJ parser */
+// The file is mapped and cut into chunks at line boundaries.
+// The elements of each chunk are counted in parallel, prefix sums give
+// where each chunk writes, then chunks are parsed in parallel
+// into preallocated arrays. Polygons are split into triangle fans.
+
+// # of elements in a range of the file
+typedef struct {
+  size_t v, vt, vn, f;
+} ObjCounts;
+
+static inline bool isBlank(char c) { return c == ' ' || c == '\t'; }
+
+static inline bool isEol(char c) { return c == '\n' || c == '\r'; }
+
+static inline const char *skipBlank(const char *p, const char *end) {
+  while (p < end && isBlank(*p)) {
+    p++;
+  }
+  return p;
+}
+
+static inline const char *skipLine(const char *p, const char *end) {
+  while (p < end && *p != '\n') {
+    p++;
+  }
+  return p;
+}
+
+// # of vertex references of a face line, p points after "f"
+static int countRefs(const char *p, const char *end) {
+  int n = 0;
+
+  while (true) {
+    p = skipBlank(p, end);
+    if (p >= end || isEol(*p) || *p == '#') {
+      return n;
+    }
+
+    n++;
+    while (p < end && !isBlank(*p) && !isEol(*p)) {
+      p++;
+    }
+  }
+}
+
+// Element type of a line
+// Return 'v', 't' (vt), 'n' (vn), 'f' or 0, and move p after the keyword
+static char lineType(const char *&p, const char *end) {
+  p = skipBlank(p, end);
+  size_t left = end - p;
+
+  if (left >= 2 && isBlank(p[1])) {
+    if (p[0] == 'v' || p[0] == 'f') {
+      return *(p++);
+    }
+  } else if (left >= 3 && p[0] == 'v' && isBlank(p[2])) {
+    if (p[1] == 't' || p[1] == 'n') {
+      p += 2;
+      return p[-1];
+    }
+  }
+
+  return 0;
+}
+
+static ObjCounts countObj(const char *p, const char *end) {
+  ObjCounts n = {0, 0, 0, 0};
+
+  while (p < end) {
+    const char *q = p;
+    char type = lineType(q, end);
+
+    if (type == 'v') {
+      n.v++;
+    } else if (type == 't') {
+      n.vt++;
+    } else if (type == 'n') {
+      n.vn++;
+    } else if (type == 'f') {
+      n.f += glm::max(countRefs(q, end) - 2, 0);
+    }
+
+    p = skipLine(q, end) + 1;
+  }
+
+  return n;
+}
+
+static inline float parseFloat(const char *&p, const char *end) {
+  float value = 0.f;
+
+  p = skipBlank(p, end);
+  from_chars_result r = from_chars(p, end, value);
+  p = r.ptr;
+
+  return value;
+}
+
+// 1-based index, or negative relative to the # of elements so far
+// Return MESH_NO_INDEX if there is no index
+static inline unsigned int parseIndex(const char *&p, const char *end,
+                                      size_t nOfElements) {
+  long idx = 0;
+  from_chars_result r = from_chars(p, end, idx);
+
+  if (r.ptr == p) {
+    return MESH_NO_INDEX;
+  }
+  p = r.ptr;
+
+  return (idx < 0) ? (unsigned int)(nOfElements + idx)
+                   : (unsigned int)(idx - 1);
+}
+
+// Parse a range of the file, the first element of each type is given by at
+static void parseObj(const char *p, const char *end, ObjCounts at, Mesh &m) {
+  while (p < end) {
+    char type = lineType(p, end);
+
+    if (type == 'v') {
+      vec3 &v = m.vertices[at.v++];
+      v.x = parseFloat(p, end);
+      v.y = parseFloat(p, end);
+      v.z = parseFloat(p, end);
+    } else if (type == 't') {
+      vec2 &uv = m.uvs[at.vt++];
+      uv.x = parseFloat(p, end);
+      uv.y = parseFloat(p, end);
+    } else if (type == 'n') {
+      vec3 &n = m.faceNormals[at.vn++];
+      n.x = parseFloat(p, end);
+      n.y = parseFloat(p, end);
+      n.z = parseFloat(p, end);
+    } else if (type == 'f') {
+      // v, v/vt, v//vn or v/vt/vn
+      unsigned int v[3], vt[3], vn[3];
+      int nOfRefs = 0;
+
+      while (true) {
+        p = skipBlank(p, end);
+        if (p >= end || isEol(*p) || *p == '#') {
+          break;
+        }
+
+        int k = glm::min(nOfRefs, 2);
+        v[k] = parseIndex(p, end, at.v);
+        vt[k] = vn[k] = MESH_NO_INDEX;
+
+        if (p < end && *p == '/') {
+          p++;
+          vt[k] = parseIndex(p, end, at.vt);
+
+          if (p < end && *p == '/') {
+            p++;
+            vn[k] = parseIndex(p, end, at.vn);
+          }
+        }
+
+        // skip anything left in this reference
+        while (p < end && !isBlank(*p) && !isEol(*p)) {
+          p++;
+        }
+
+        // fan: (first, previous, current)
+        if (nOfRefs >= 2) {
+          Face &f = m.faces[at.f++];
+          f.v1 = v[0], f.v2 = v[1], f.v3 = v[2];
+          f.vt1 = vt[0], f.vt2 = vt[1], f.vt3 = vt[2];
+          f.vn1 = vn[0], f.vn2 = vn[1], f.vn3 = vn[2];
+
+          v[1] = v[2], vt[1] = vt[2], vn[1] = vn[2];
+        }
+        nOfRefs++;
+      }
+    }
+
+    p = skipLine(p, end) + 1;
+  }
+}
+
+// Faces without normals get the normal of their plane,
+// appended after the normals of the file
+static void fillMissingNormals(Mesh &m) {
+  for (size_t i = 0; i < m.faces.size(); i++) {
+    Face &f = m.faces[i];
+
+    if (f.vn1 != MESH_NO_INDEX && f.vn2 != MESH_NO_INDEX &&
+        f.vn3 != MESH_NO_INDEX) {
+      continue;
+    }
+
+    vec3 A = m.vertices[f.v1];
+    vec3 B = m.vertices[f.v2];
+    vec3 C = m.vertices[f.v3];
+    vec3 N = cross(B - A, C - A);
+    float len = length(N);
+
+    f.vn1 = f.vn2 = f.vn3 = m.faceNormals.size();
+    m.faceNormals.push_back((len > 0.f) ? N / len : vec3(0, 1, 0));
+  }
+}
+
+// Parse an obj file with the thread pool
+Mesh parseObj(const std::string filename, ThreadPool &pool) {
+  Mesh outMesh;
+  MappedFile file;
+
+  if (!file.open(filename)) {
+    return outMesh;
+  }
+
+  const char *begin = file.data;
+  const char *end = file.data + file.size;
+
+  int nOfChunks =
+      (int)glm::min<size_t>(pool.size() * 8, file.size / 65536 + 1);
+
+  vector<const char *> bounds;
+  splitLines(begin, end, nOfChunks, bounds);
+
+  // first element of each chunk
+  vector<ObjCounts> first(nOfChunks + 1);
+  first[0] = {0, 0, 0, 0};
+
+  pool.parallelFor(0, nOfChunks, 1, [&](int chunkBegin, int chunkEnd) {
+    for (int c = chunkBegin; c < chunkEnd; c++) {
+      first[c + 1] = countObj(bounds[c], bounds[c + 1]);
+    }
+  });
+
+  for (int c = 0; c < nOfChunks; c++) {
+    first[c + 1].v += first[c].v;
+    first[c + 1].vt += first[c].vt;
+    first[c + 1].vn += first[c].vn;
+    first[c + 1].f += first[c].f;
+  }
+
+  ObjCounts total = first[nOfChunks];
+  outMesh.vertices.resize(total.v);
+  outMesh.uvs.resize(total.vt);
+  outMesh.faceNormals.reserve(total.vn + total.f);
+  outMesh.faceNormals.resize(total.vn);
+  outMesh.faces.resize(total.f);
+
+  pool.parallelFor(0, nOfChunks, 1, [&](int chunkBegin, int chunkEnd) {
+    for (int c = chunkBegin; c < chunkEnd; c++) {
+      parseObj(bounds[c], bounds[c + 1], first[c], outMesh);
+    }
+  });
+
+  fillMissingNormals(outMesh);
+
+  return outMesh;
+}
+
+Mesh loadObj(std::string filename) {
+  ThreadPool pool;
+
+  return loadObj(filename, pool);
+}
+
+// Load a mesh from its cache if it is up to date,
+// otherwise parse the obj file and write the cache
+Mesh loadObj(std::string filename, ThreadPool &pool) {
+  Mesh outMesh;
+
+  if (readMeshCache(outMesh, filename)) {
+    return outMesh;
+  }
+
+  outMesh = parseObj(filename, pool);
+
+  if (!outMesh.faces.empty()) {
+    writeMeshCache(outMesh, filename);
+  }
+
+  return outMesh;
+}
+
+/* Binary mesh cache */
+// [header (64 bytes)][vertices][uvs][normals][faces]
+// Written next to the obj file. It is only used
+// if the size and the modification time of the obj file match.
+
+typedef struct {
+  char magic[4];    // MESH_CACHE_MAGIC
+  uint32_t version; // MESH_CACHE_VERSION
+  uint64_t objSize;
+  int64_t objTime; // modification time of the obj file
+  uint64_t nOfVertices, nOfUvs, nOfNormals, nOfFaces;
+  uint32_t reserved[2];
+} MeshCacheHeader;
+
+static_assert(sizeof(MeshCacheHeader) == 64,
+              "MeshCacheHeader must be 64 bytes");
+static_assert(sizeof(Face) == 9 * sizeof(uint32_t), "Face must be packed");
+
+string meshCacheName(const string objFile) { return objFile + ".cache"; }
+
+// size and modification time of a file
+static bool fileStamp(const string fileName, uint64_t &size, int64_t &time) {
+  struct stat st;
+
+  if (stat(fileName.c_str(), &st) != 0) {
+    return false;
+  }
+
+  size = st.st_size;
+  time = st.st_mtime;
+
+  return true;
+}
+
+bool readMeshCache(Mesh &m, const string objFile) {
+  uint64_t objSize;
+  int64_t objTime;
+
+  if (!fileStamp(objFile, objSize, objTime)) {
+    return false;
+  }
+
+  // quietly fall back to parsing if there is no cache
+  string cacheFile = meshCacheName(objFile);
+  uint64_t cacheSize;
+  int64_t cacheTime;
+  if (!fileStamp(cacheFile, cacheSize, cacheTime)) {
+    return false;
+  }
+
+  MappedFile file;
+  if (!file.open(cacheFile) || file.size < sizeof(MeshCacheHeader)) {
+    return false;
+  }
+
+  MeshCacheHeader header;
+  memcpy(&header, file.data, sizeof(header));
+
+  if (memcmp(header.magic, MESH_CACHE_MAGIC, 4) != 0 ||
+      header.version != MESH_CACHE_VERSION || header.objSize != objSize ||
+      header.objTime != objTime) {
+    return false;
+  }
+
+  size_t bytes = sizeof(header) + header.nOfVertices * sizeof(vec3) +
+                 header.nOfUvs * sizeof(vec2) +
+                 header.nOfNormals * sizeof(vec3) +
+                 header.nOfFaces * sizeof(Face);
+  if (bytes != file.size) {
+    return false;
+  }
+
+  const char *p = file.data + sizeof(header);
+
+  m.vertices.resize(header.nOfVertices);
+  memcpy(m.vertices.data(), p, header.nOfVertices * sizeof(vec3));
+  p += header.nOfVertices * sizeof(vec3);
+
+  m.uvs.resize(header.nOfUvs);
+  memcpy(m.uvs.data(), p, header.nOfUvs * sizeof(vec2));
+  p += header.nOfUvs * sizeof(vec2);
+
+  m.faceNormals.resize(header.nOfNormals);
+  memcpy(m.faceNormals.data(), p, header.nOfNormals * sizeof(vec3));
+  p += header.nOfNormals * sizeof(vec3);
+
+  m.faces.resize(header.nOfFaces);
+  memcpy(m.faces.data(), p, header.nOfFaces * sizeof(Face));
+
+  return true;
+}
+
+// The cache is optional, so failing to write it is not an error
+void writeMeshCache(Mesh &m, const string objFile) {
+  MeshCacheHeader header;
+  memset(&header, 0, sizeof(header));
+
+  memcpy(header.magic, MESH_CACHE_MAGIC, 4);
+  header.version = MESH_CACHE_VERSION;
+  if (!fileStamp(objFile, header.objSize, header.objTime)) {
+    return;
+  }
+  header.nOfVertices = m.vertices.size();
+  header.nOfUvs = m.uvs.size();
+  header.nOfNormals = m.faceNormals.size();
+  header.nOfFaces = m.faces.size();
+
+  // write to a temporary file first,
+  // so a concurrent reader never sees a partial cache
+  string cacheFile = meshCacheName(objFile);
+  string tempFile = cacheFile + ".tmp";
+
+  ofstream output(tempFile, ios::binary);
+  if (!(output.good())) {
+    return;
+  }
+
+  output.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  output.write(reinterpret_cast<const char *>(m.vertices.data()),
+               m.vertices.size() * sizeof(vec3));
+  output.write(reinterpret_cast<const char *>(m.uvs.data()),
+               m.uvs.size() * sizeof(vec2));
+  output.write(reinterpret_cast<const char *>(m.faceNormals.data()),
+               m.faceNormals.size() * sizeof(vec3));
+  output.write(reinterpret_cast<const char *>(m.faces.data()),
+               m.faces.size() * sizeof(Face));
+  output.close();
+
+  if (!output.good() || rename(tempFile.c_str(), cacheFile.c_str()) != 0) {
+    remove(tempFile.c_str());
+  }
+}
+
+/* Mesh class */
+void Mesh::translate(glm::vec3 xyz) {
+  // move each vertex with xyz
+  for (size_t i = 0; i < vertices.size(); i++) {
+    vertices[i] += xyz;
+  }
+
+  // update aabb
+  min += xyz;
+  max += xyz;
+}
+
+void Mesh::scale(glm::vec3 xyz) {
+  // scale each vertex with xyz
+  for (size_t i = 0; i < vertices.size(); i++) {
+    vertices[i].x *= xyz.x;
+    vertices[i].y *= xyz.y;
+    vertices[i].z *= xyz.z;
+  }
+
+  // update aabb
+  min.x *= xyz.x;
+  min.y *= xyz.y;
+  min.z *= xyz.z;
+
+  max.x *= xyz.x;
+  max.y *= xyz.y;
+  max.z *= xyz.z;
+}
+
+void findAABB(Mesh &mesh) {
+  int nOfVtxs = mesh.vertices.size();
+  glm::vec3 min(0, 0, 0), max(0, 0, 0);
+
+  for (size_t i = 0; i < nOfVtxs; i++) {
+    glm::vec3 vtx = mesh.vertices[i];
+
+    // x
+    if (vtx.x > max.x) {
+      max.x = vtx.x;
+    }
+    if (vtx.x < min.x) {
+      min.x = vtx.x;
+    }
+    // y
+    if (vtx.y > max.y) {
+      max.y = vtx.y;
+    }
+    if (vtx.y < min.y) {
+      min.y = vtx.y;
+    }
+    // z
+    if (vtx.z > max.z) {
+      max.z = vtx.z;
+    }
+    if (vtx.z < min.z) {
+      min.z = vtx.z;
+    }
+  }
+
+  mesh.min = min;
+  mesh.max = max;
+}
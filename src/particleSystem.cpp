@@ -0,0 +1,646 @@
+#include "particleSystem.h"
+
+#include <chrono>
+
+// Distance and gradient of count <= PARTICLE_BLOCK particles,
+// exact for distances below threshold
+// Broad phase: a coarse level is never above the full resolution grid,
+// so a particle at or above threshold on it is done, and only the
+// others query the full resolution grid.
+static void querySdf(SdfPyramid &pyramid, float tolerance, const float *x,
+                     const float *y, const float *z, int count,
+                     float threshold, float *dists, float *gx, float *gy,
+                     float *gz) {
+  Grid &broad = pyramid.getGrid(pyramid.getLevel(tolerance));
+
+  broad.getDistanceGradients(x, y, z, count, dists, gx, gy, gz);
+
+  if (&broad == pyramid.fine) {
+    return;
+  }
+
+  int nearIdxs[PARTICLE_BLOCK];
+  float nearX[PARTICLE_BLOCK], nearY[PARTICLE_BLOCK], nearZ[PARTICLE_BLOCK];
+  int nOfNear = 0;
+
+  for (int i = 0; i < count; i++) {
+    if (dists[i] < threshold) {
+      nearIdxs[nOfNear] = i;
+      nearX[nOfNear] = x[i];
+      nearY[nOfNear] = y[i];
+      nearZ[nOfNear] = z[i];
+      nOfNear++;
+    }
+  }
+
+  float nearDists[PARTICLE_BLOCK];
+  float nearGx[PARTICLE_BLOCK], nearGy[PARTICLE_BLOCK], nearGz[PARTICLE_BLOCK];
+
+  pyramid.fine->getDistanceGradients(nearX, nearY, nearZ, nOfNear, nearDists,
+                                     nearGx, nearGy, nearGz);
+
+  for (int i = 0; i < nOfNear; i++) {
+    int k = nearIdxs[i];
+
+    dists[k] = nearDists[i];
+    gx[k] = nearGx[i];
+    gy[k] = nearGy[i];
+    gz[k] = nearGz[i];
+  }
+}
+
+/* Member functions of ParticleSystem */
+void ParticleSystem::clear() {
+  px.clear();
+  py.clear();
+  pz.clear();
+  vx.clear();
+  vy.clear();
+  vz.clear();
+  m.clear();
+  ids.clear();
+  stillSteps.clear();
+  nOfActive = 0;
+  sleepHashValid = false;
+}
+
+void ParticleSystem::add(vec3 pos, vec3 v, float mass) {
+  px.push_back(pos.x);
+  py.push_back(pos.y);
+  pz.push_back(pos.z);
+  vx.push_back(v.x);
+  vy.push_back(v.y);
+  vz.push_back(v.z);
+  m.push_back(mass);
+  ids.push_back(ids.size());
+  stillSteps.push_back(0);
+
+  // awake, so it goes before the sleeping particles
+  int last = size() - 1;
+  if (nOfActive < last) {
+    swapParticles(nOfActive, last);
+    sleepHashValid = false;
+  }
+  nOfActive++;
+}
+
+// Swap particles i and j in all arrays
+void ParticleSystem::swapParticles(int i, int j) {
+  swap(px[i], px[j]);
+  swap(py[i], py[j]);
+  swap(pz[i], pz[j]);
+  swap(vx[i], vx[j]);
+  swap(vy[i], vy[j]);
+  swap(vz[i], vz[j]);
+  swap(m[i], m[j]);
+  swap(ids[i], ids[j]);
+  swap(stillSteps[i], stillSteps[j]);
+}
+
+// Wake all sleeping particles
+void ParticleSystem::wakeAll() {
+  for (int i = nOfActive; i < size(); i++) {
+    stillSteps[i] = 0;
+  }
+
+  nOfActive = size();
+  sleepHashValid = false;
+}
+
+// Advance the awake particles by dt
+void ParticleSystem::step(SdfPyramid &pyramid, ThreadPool &pool) {
+  if (sleepSteps > 0) {
+    updateSleep(pyramid, pool);
+  } else if (nOfActive < size()) {
+    wakeAll();
+  }
+
+  if (reorderInterval > 0 && nOfSteps % reorderInterval == 0) {
+    reorder(*pyramid.fine, pool);
+  }
+  nOfSteps++;
+
+  if (contactRadius > 0.f) {
+    collideParticles(pool);
+  }
+
+  int nOfPs = nOfActive;
+  int nOfBlocks = (nOfPs + PARTICLE_BLOCK - 1) / PARTICLE_BLOCK;
+
+  pool.parallelFor(0, nOfBlocks, PARTICLE_GRAIN, [&](int bBegin, int bEnd) {
+    for (int b = bBegin; b < bEnd; b++) {
+      int begin = b * PARTICLE_BLOCK;
+      int end = glm::min(begin + PARTICLE_BLOCK, nOfPs);
+
+      stepBlock(pyramid, begin, end);
+    }
+  });
+}
+
+// Advance the particles [begin, end), a block of at most PARTICLE_BLOCK
+// Each phase is a loop over the block, so the sdf is queried
+// for the whole block at once.
+void ParticleSystem::stepBlock(SdfPyramid &pyramid, int begin, int end) {
+  int count = end - begin;
+
+  float *x = &px[begin], *y = &py[begin], *z = &pz[begin];
+  float *u = &vx[begin], *v = &vy[begin], *w = &vz[begin];
+
+  float dists[PARTICLE_BLOCK];
+  float gx[PARTICLE_BLOCK], gy[PARTICLE_BLOCK], gz[PARTICLE_BLOCK];
+
+  // positions at the beginning of the step, see sleepDistance
+  float x0[PARTICLE_BLOCK], y0[PARTICLE_BLOCK], z0[PARTICLE_BLOCK];
+
+  for (int i = 0; i < count; i++) {
+    x0[i] = x[i];
+    y0[i] = y[i];
+    z0[i] = z[i];
+
+    u[i] += dt * gravity.x;
+    v[i] += dt * gravity.y;
+    w[i] += dt * gravity.z;
+  }
+
+  // collision detection
+  // one query gives the trilinear distance and its gradient
+  querySdf(pyramid, broadTolerance, x, y, z, count, collisionDistance, dists,
+           gx, gy, gz);
+
+  for (int i = 0; i < count; i++) {
+    vec3 grad(gx[i], gy[i], gz[i]);
+
+    if (dists[i] < collisionDistance && grad != vec3(0)) {
+      // pointing into the object, as getGradient()
+      vec3 n = -normalize(grad);
+      vec3 vel(u[i], v[i], w[i]);
+
+      vec3 vVer = -dot(vel, -n) * (-n);
+      vec3 vHor = vel - dot(vel, -n) * (-n);
+
+      vel = (vVer + vHor) * friction;
+      u[i] = vel.x;
+      v[i] = vel.y;
+      w[i] = vel.z;
+    }
+
+    // update position
+    x[i] += dt * u[i];
+    y[i] += dt * v[i];
+    z[i] += dt * w[i];
+  }
+
+  // if a particle has moved into an object
+  // push it out
+  querySdf(pyramid, broadTolerance, x, y, z, count, 0.f, dists, gx, gy, gz);
+
+  for (int i = 0; i < count; i++) {
+    vec3 grad(gx[i], gy[i], gz[i]);
+
+    if (dists[i] < 0.f && grad != vec3(0)) {
+      // twice the depth, for visualization convenience
+      vec3 push = 2.f * dists[i] * normalize(grad);
+
+      x[i] -= push.x;
+      y[i] -= push.y;
+      z[i] -= push.z;
+    }
+  }
+
+  if (sleepSteps == 0) {
+    return;
+  }
+
+  int *still = &stillSteps[begin];
+
+  for (int i = 0; i < count; i++) {
+    vec3 vel(u[i], v[i], w[i]);
+    vec3 move(x[i] - x0[i], y[i] - y0[i], z[i] - z0[i]);
+
+    bool isStill = dot(vel, vel) < sleepSpeed * sleepSpeed &&
+                   dot(move, move) < sleepDistance * sleepDistance;
+
+    still[i] = isStill ? still[i] + 1 : 0;
+  }
+}
+
+// Separate the awake particles which overlap and bounce the ones which
+// approach each other, return the # of overlapping pairs
+// Broad phase: the particles are sorted into cells of 2 * contactRadius,
+// so the ones touching a particle are in the 27 cells around it, and
+// the positions of a row of cells are contiguous. Sleeping particles
+// are in sleepHash, which is built again only when particles fall
+// asleep, so the hash of the awake particles is the only one built
+// every step.
+// Narrow phase: the neighbours of a particle act as the surface in
+// step(), with the sum of the contact directions as the normal and
+// their mean velocity as the velocity of the surface. Each particle is
+// also pushed out of each neighbour by half the overlap.
+// A sleeping neighbour only moves the awake particle, and is woken up
+// in the next step if the awake particle is faster than sleepSpeed.
+int ParticleSystem::collideParticles(ThreadPool &pool) {
+  int nOfPs = nOfActive;
+  int nOfSleeping = size() - nOfActive;
+  float h = 2.f * contactRadius;
+
+  auto t0 = chrono::steady_clock::now();
+
+  hash.build(px.data(), py.data(), pz.data(), nOfPs, h, pool);
+
+  if (nOfSleeping > 0 && (!sleepHashValid || sleepHash.cellSize != h)) {
+    // as many buckets as particles, so that a few sleeping particles
+    // are not all in the buckets around every awake one
+    sleepHash.build(&px[nOfPs], &py[nOfPs], &pz[nOfPs], nOfSleeping, h,
+                    pool, size());
+    sleepBase = nOfPs;
+    sleepSlots.resize(nOfSleeping);
+    for (int t = 0; t < nOfSleeping; t++) {
+      sleepSlots[sleepHash.order[t]] = t;
+    }
+
+    // cells around a sleeping particle, 1 bit per cell wrapped around
+    // like the buckets but with up to 8 times as many, an awake particle
+    // whose bit is not set does not touch any sleeping one
+    nearBits = sleepHash.bits + ivec3(sleepHash.tableBits <= 27);
+    int nOfNearBits = nearBits.x + nearBits.y + nearBits.z;
+    sleepNear.assign((size_t(1) << nOfNearBits) / 64 + 1, 0);
+
+    ivec3 lastCell(0);
+
+    for (int t = 0; t < nOfSleeping; t++) {
+      vec3 p(sleepHash.xs[t], sleepHash.ys[t], sleepHash.zs[t]);
+      ivec3 cell = sleepHash.getCell(p);
+
+      // the points of a cell are mostly consecutive
+      if (t > 0 && cell == lastCell) {
+        continue;
+      }
+      lastCell = cell;
+
+      for (int c = 0; c < 27; c++) {
+        ivec3 d(c % 3 - 1, (c / 3) % 3 - 1, c / 9 - 1);
+        uint32_t k = getNearKey(cell + d);
+        sleepNear[k >> 6] |= uint64_t(1) << (k & 63);
+      }
+    }
+
+    sleepHashValid = true;
+  }
+
+  auto t1 = chrono::steady_clock::now();
+  hashTime = chrono::duration<double>(t1 - t0).count();
+
+  newPx.resize(nOfPs);
+  newPy.resize(nOfPs);
+  newPz.resize(nOfPs);
+  newVx.resize(nOfPs);
+  newVy.resize(nOfPs);
+  newVz.resize(nOfPs);
+
+  // particles are visited in the order of the hash,
+  // so neighbours are read from nearby memory
+  int nOfBlocks = (nOfPs + PARTICLE_BLOCK - 1) / PARTICLE_BLOCK;
+  vector<int> blockContacts(nOfBlocks, 0);
+  vector<vector<int>> blockWakes(nOfBlocks);
+
+  pool.parallelFor(0, nOfBlocks, PARTICLE_GRAIN, [&](int bBegin, int bEnd) {
+    for (int b = bBegin; b < bEnd; b++) {
+      int end = glm::min((b + 1) * PARTICLE_BLOCK, nOfPs);
+
+      for (int s = b * PARTICLE_BLOCK; s < end; s++) {
+        int i = hash.order[s];
+        vec3 p(hash.xs[s], hash.ys[s], hash.zs[s]);
+        vec3 vel = getVelocity(i);
+        ivec3 cell = hash.getCell(p);
+        bool wakes = dot(vel, vel) > sleepSpeed * sleepSpeed;
+
+        vec3 normal(0), vSurface(0), push(0);
+        int nOfContacts = 0;
+
+        // the sorted points [tBegin, tEnd) of hs, all within cellSize
+        // are contacts, base: index of the first particle of hs
+        auto visit = [&](SpatialHash &hs, int base, int tBegin, int tEnd) {
+          for (int t = tBegin; t < tEnd; t++) {
+            vec3 d = p - vec3(hs.xs[t], hs.ys[t], hs.zs[t]);
+            float dist2 = dot(d, d);
+
+            // no direction between coincident particles
+            if (dist2 >= h * h || dist2 == 0.f) {
+              continue;
+            }
+
+            int j = base + hs.order[t];
+            float dist = sqrt(dist2);
+            vec3 dir = d / dist;
+
+            normal += dir;
+            vSurface += getVelocity(j);
+            push += 0.5f * (h - dist) * dir;
+            nOfContacts++;
+            blockContacts[b] += (i < j);
+
+            if (j >= nOfPs && wakes) {
+              blockWakes[b].push_back(j);
+            }
+          }
+        };
+
+        // 9 rows of 3 cells along x, a row is one range of buckets
+        // unless it wraps around
+        auto visitCells = [&](SpatialHash &hs, int base) {
+          uint32_t mx = (1u << hs.bits.x) - 1;
+          uint32_t x = uint32_t(cell.x) & mx;
+
+          for (int r = 0; r < 9; r++) {
+            ivec3 rowCell = cell + ivec3(0, r % 3 - 1, r / 3 - 1);
+            uint32_t row = hs.getBucket(rowCell) - x;
+
+            if (x >= 1 && x + 1 <= mx) {
+              visit(hs, base, hs.starts[row + x - 1], hs.starts[row + x + 2]);
+            } else {
+              for (int dx = -1; dx <= 1; dx++) {
+                uint32_t bucket = row + ((x + dx) & mx);
+                visit(hs, base, hs.starts[bucket], hs.starts[bucket + 1]);
+              }
+            }
+          }
+        };
+
+        visitCells(hash, 0);
+        uint32_t k = getNearKey(cell);
+        if (nOfSleeping > 0 && (sleepNear[k >> 6] >> (k & 63) & 1)) {
+          visitCells(sleepHash, sleepBase);
+        }
+
+        if (nOfContacts > 0) {
+          vSurface /= float(nOfContacts);
+          vec3 vRel = vel - vSurface;
+
+          // approaching, same response as step()
+          if (normal != vec3(0) && dot(vRel, normal) < 0.f) {
+            // pointing into the neighbours, as getGradient()
+            vec3 n = -normalize(normal);
+
+            vec3 vVer = -dot(vRel, -n) * (-n);
+            vec3 vHor = vRel - dot(vRel, -n) * (-n);
+
+            vel = vSurface + (vVer + vHor) * friction;
+          }
+
+          p += push;
+        }
+
+        newPx[i] = p.x;
+        newPy[i] = p.y;
+        newPz[i] = p.z;
+        newVx[i] = vel.x;
+        newVy[i] = vel.y;
+        newVz[i] = vel.z;
+      }
+    }
+  });
+
+  // the sleeping particles after the awake ones are kept
+  int grain = PARTICLE_GRAIN * PARTICLE_BLOCK;
+
+  pool.parallelFor(0, nOfPs, grain, [&](int begin, int end) {
+    for (int i = begin; i < end; i++) {
+      px[i] = newPx[i];
+      py[i] = newPy[i];
+      pz[i] = newPz[i];
+      vx[i] = newVx[i];
+      vy[i] = newVy[i];
+      vz[i] = newVz[i];
+    }
+  });
+
+  int nOfPairs = 0;
+  for (int b = 0; b < nOfBlocks; b++) {
+    nOfPairs += blockContacts[b];
+    wakeIdxs.insert(wakeIdxs.end(), blockWakes[b].begin(),
+                    blockWakes[b].end());
+  }
+
+  return nOfPairs;
+}
+
+// Bit of cell c in sleepNear
+// Cells wrap around like the buckets of sleepHash, along nearBits.
+uint32_t ParticleSystem::getNearKey(ivec3 c) {
+  uint32_t x = uint32_t(c.x) & ((1u << nearBits.x) - 1);
+  uint32_t y = uint32_t(c.y) & ((1u << nearBits.y) - 1);
+  uint32_t z = uint32_t(c.z) & ((1u << nearBits.z) - 1);
+
+  return x | (y << nearBits.x) | (z << (nearBits.x + nearBits.y));
+}
+
+// Sort the awake particles by the Morton code of their cell of grid
+// Cells are merged by 2 along each axis until the grid fits in the
+// 10 bits per axis of mortonCode(), particles outside the grid go to
+// the nearest cell. All arrays are permuted, ids included.
+void ParticleSystem::reorder(Grid &grid, ThreadPool &pool) {
+  int nOfPs = nOfActive;
+  ivec3 n = grid.nOfCells;
+  int nMax = glm::max(glm::max(n.x, n.y), n.z);
+
+  int shift = 0;
+  while (((nMax - 1) >> shift) >= 1024) {
+    shift++;
+  }
+
+  vec3 maxCell = vec3(glm::max(n - 1, ivec3(0)));
+  int grain = PARTICLE_GRAIN * PARTICLE_BLOCK;
+
+  sortKeys.resize(nOfPs);
+  sortOrder.resize(nOfPs);
+
+  pool.parallelFor(0, nOfPs, grain, [&](int begin, int end) {
+    for (int i = begin; i < end; i++) {
+      vec3 u = (getPos(i) - grid.origin) / grid.cellSize;
+      ivec3 idx(glm::clamp(u, vec3(0), maxCell));
+
+      sortKeys[i] =
+          mortonCode(ivec3(idx.x >> shift, idx.y >> shift, idx.z >> shift));
+      sortOrder[i] = i;
+    }
+  });
+
+  radixSort(sortKeys, sortOrder, 30, pool);
+  permute(0, sortOrder, pool);
+
+  nOfReorders++;
+}
+
+// Put the particles which woke up before the sleeping ones, and every
+// sleepSteps steps the ones which fell asleep after the awake ones
+// Particles wake up if an awake particle touched them in the last
+// contacts, or if the sdf has moved since the last step and they are
+// within collisionDistance of it, plus the move.
+// Particles fall asleep together so that sleepHash is built again at
+// most once every sleepSteps steps, a still particle stays awake until
+// then. Waking up only hides a particle in sleepHash.
+void ParticleSystem::updateSleep(SdfPyramid &pyramid, ThreadPool &pool) {
+  int nOfPs = size();
+
+  // only when the sdf moves, so it may visit all sleeping particles
+  vec3 origin = pyramid.fine->origin;
+
+  if (origin != colliderOrigin && nOfActive < nOfPs) {
+    float reach = collisionDistance + length(origin - colliderOrigin);
+    int nOfBlocks = (nOfPs - nOfActive + PARTICLE_BLOCK - 1) / PARTICLE_BLOCK;
+    vector<vector<int>> blockWakes(nOfBlocks);
+
+    pool.parallelFor(0, nOfBlocks, PARTICLE_GRAIN, [&](int bBegin, int bEnd) {
+      float dists[PARTICLE_BLOCK];
+      float gx[PARTICLE_BLOCK], gy[PARTICLE_BLOCK], gz[PARTICLE_BLOCK];
+
+      for (int b = bBegin; b < bEnd; b++) {
+        int begin = nOfActive + b * PARTICLE_BLOCK;
+        int end = glm::min(begin + PARTICLE_BLOCK, nOfPs);
+
+        querySdf(pyramid, broadTolerance, &px[begin], &py[begin], &pz[begin],
+                 end - begin, reach, dists, gx, gy, gz);
+
+        for (int i = begin; i < end; i++) {
+          if (dists[i - begin] < reach) {
+            blockWakes[b].push_back(i);
+          }
+        }
+      }
+    });
+
+    for (int b = 0; b < nOfBlocks; b++) {
+      wakeIdxs.insert(wakeIdxs.end(), blockWakes[b].begin(),
+                      blockWakes[b].end());
+    }
+  }
+  colliderOrigin = origin;
+
+  // a particle may be touched by several awake ones
+  sort(wakeIdxs.begin(), wakeIdxs.end());
+  wakeIdxs.erase(unique(wakeIdxs.begin(), wakeIdxs.end()), wakeIdxs.end());
+
+  // in increasing order, a woken particle is at or after nOfActive
+  // and the sleeping particle swapped with it is not woken up
+  for (size_t k = 0; k < wakeIdxs.size(); k++) {
+    wake(wakeIdxs[k]);
+  }
+  wakeIdxs.clear();
+
+  if (nOfSteps % sleepSteps != 0) {
+    return;
+  }
+
+  bool fellAsleep = false;
+  for (int i = 0; i < nOfActive && !fellAsleep; i++) {
+    fellAsleep = (stillSteps[i] >= sleepSteps);
+  }
+
+  if (!fellAsleep) {
+    return;
+  }
+
+  // [awake | fell asleep | asleep]
+  int end = nOfActive;
+  nOfActive = partition(0, end, pool);
+
+  // the particles which fell asleep stop
+  for (int i = nOfActive; i < end; i++) {
+    vx[i] = 0.f;
+    vy[i] = 0.f;
+    vz[i] = 0.f;
+  }
+
+  sleepHashValid = false;
+}
+
+// Move sleeping particle j to nOfActive, the end of the awake ones
+// In sleepHash, j is hidden by an infinite position and the sleeping
+// particle at nOfActive takes the place of j.
+void ParticleSystem::wake(int j) {
+  int a = nOfActive;
+
+  if (sleepHashValid) {
+    int slotJ = sleepSlots[j - sleepBase];
+    int slotA = sleepSlots[a - sleepBase];
+
+    sleepHash.xs[slotJ] = INFINITY;
+    sleepHash.ys[slotJ] = INFINITY;
+    sleepHash.zs[slotJ] = INFINITY;
+
+    sleepHash.order[slotA] = j - sleepBase;
+    sleepSlots[j - sleepBase] = slotA;
+  }
+
+  swapParticles(a, j);
+  stillSteps[a] = 0;
+  nOfActive++;
+}
+
+// Stable partition of [begin, end), awake particles first
+// Return the # of awake particles in the range.
+int ParticleSystem::partition(int begin, int end, ThreadPool &pool) {
+  int count = end - begin;
+  int nOfAwake = 0;
+
+  sortKeys.resize(count);
+  sortOrder.resize(count);
+
+  for (int i = 0; i < count; i++) {
+    sortKeys[i] = (stillSteps[begin + i] >= sleepSteps);
+    sortOrder[i] = i;
+    nOfAwake += (sortKeys[i] == 0);
+  }
+
+  radixSort(sortKeys, sortOrder, 1, pool);
+  permute(begin, sortOrder, pool);
+
+  return nOfAwake;
+}
+
+// Move particle begin + order[i] to begin + i, for all arrays
+void ParticleSystem::permute(int begin, const vector<int> &order,
+                             ThreadPool &pool) {
+  int count = order.size();
+  int grain = PARTICLE_GRAIN * PARTICLE_BLOCK;
+
+  newPx.resize(count);
+  newPy.resize(count);
+  newPz.resize(count);
+  newVx.resize(count);
+  newVy.resize(count);
+  newVz.resize(count);
+  newM.resize(count);
+  newIds.resize(count);
+  newStillSteps.resize(count);
+
+  pool.parallelFor(0, count, grain, [&](int tBegin, int tEnd) {
+    for (int i = tBegin; i < tEnd; i++) {
+      int k = begin + order[i];
+
+      newPx[i] = px[k];
+      newPy[i] = py[k];
+      newPz[i] = pz[k];
+      newVx[i] = vx[k];
+      newVy[i] = vy[k];
+      newVz[i] = vz[k];
+      newM[i] = m[k];
+      newIds[i] = ids[k];
+      newStillSteps[i] = stillSteps[k];
+    }
+  });
+
+  pool.parallelFor(0, count, grain, [&](int tBegin, int tEnd) {
+    for (int i = tBegin; i < tEnd; i++) {
+      px[begin + i] = newPx[i];
+      py[begin + i] = newPy[i];
+      pz[begin + i] = newPz[i];
+      vx[begin + i] = newVx[i];
+      vy[begin + i] = newVy[i];
+      vz[begin + i] = newVz[i];
+      m[begin + i] = newM[i];
+      ids[begin + i] = newIds[i];
+      stillSteps[begin + i] = newStillSteps[i];
+    }
+  });
+}
@@ -0,0 +1,64 @@
+#include "radixSort.h"
+
+#include <algorithm>
+
+// Sort keys and carry values along, only the lowest bits of keys count
+// keys and values have the same size, e.g. values is the identity
+// permutation to get the sorting order.
+void radixSort(vector<uint32_t> &keys, vector<int> &values, int bits,
+               ThreadPool &pool) {
+  int n = keys.size();
+  int nOfBlocks = (n + RADIX_BLOCK - 1) / RADIX_BLOCK;
+
+  vector<uint32_t> tmpKeys(n);
+  vector<int> tmpValues(n);
+
+  // counts[d * nOfBlocks + b]: # of digit d in block b,
+  // then where block b writes its first digit d
+  vector<int> counts(size_t(RADIX_BUCKETS) * nOfBlocks);
+
+  for (int shift = 0; shift < bits; shift += RADIX_BITS) {
+    pool.parallelFor(0, nOfBlocks, 1, [&](int bBegin, int bEnd) {
+      for (int b = bBegin; b < bEnd; b++) {
+        int hist[RADIX_BUCKETS] = {0};
+        int end = min((b + 1) * RADIX_BLOCK, n);
+
+        for (int i = b * RADIX_BLOCK; i < end; i++) {
+          hist[(keys[i] >> shift) & (RADIX_BUCKETS - 1)]++;
+        }
+        for (int d = 0; d < RADIX_BUCKETS; d++) {
+          counts[size_t(d) * nOfBlocks + b] = hist[d];
+        }
+      }
+    });
+
+    // exclusive prefix sum, digit first, then block
+    int sum = 0;
+    for (size_t c = 0; c < counts.size(); c++) {
+      int count = counts[c];
+      counts[c] = sum;
+      sum += count;
+    }
+
+    pool.parallelFor(0, nOfBlocks, 1, [&](int bBegin, int bEnd) {
+      for (int b = bBegin; b < bEnd; b++) {
+        int offsets[RADIX_BUCKETS];
+        int end = min((b + 1) * RADIX_BLOCK, n);
+
+        for (int d = 0; d < RADIX_BUCKETS; d++) {
+          offsets[d] = counts[size_t(d) * nOfBlocks + b];
+        }
+
+        for (int i = b * RADIX_BLOCK; i < end; i++) {
+          int dst = offsets[(keys[i] >> shift) & (RADIX_BUCKETS - 1)]++;
+
+          tmpKeys[dst] = keys[i];
+          tmpValues[dst] = values[i];
+        }
+      }
+    });
+
+    keys.swap(tmpKeys);
+    values.swap(tmpValues);
+  }
+}
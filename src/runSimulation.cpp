@@ -0,0 +1,291 @@
+#include "particleSystem.h"
+#include "sdfIO.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+
+Grid grid;
+MappedFile sdfMap;
+SdfPyramid pyramid;
+MappedFile levelMaps[PYRAMID_MAX_LEVELS];
+ParticleSystem particleSystem;
+
+/* command line options */
+string sdfFile = "sdfBunnyBatty.txt"; // SDFGen text, or binary *.sdf
+string particleFile = "particles.txt";
+int nOfSteps = 1000;
+int nOfThreads = 0;    // 0: one thread per hardware thread
+int nOfRandom = 0;     // > 0: random particles instead of particleFile
+unsigned int seed = 0; // of velocities, masses and random positions
+
+bool initGrid(ThreadPool &);
+void loadPoints(ParticleSystem &, const string);
+void randomPoints(ParticleSystem &, int);
+uint64_t checksum(ParticleSystem &);
+float gridLinesPerBlock(ParticleSystem &, Grid &);
+void printUsage();
+float randf();
+
+// Advance the particles of simulation.cpp by a fixed # of steps
+// without a window, and report the throughput of the steps only.
+// Initial velocities and masses are drawn from seed and step() does not
+// depend on the # of threads, so the checksum of the final positions
+// is the same for the same inputs and the same build.
+// The checksum follows the ids of the particles, i.e. the order of the
+// input, but -reorder changes which particles share a SIMD batch and
+// the order in which contacts are summed, so runs with different
+// -reorder may differ by rounding.
+int main(int argc, char const *argv[]) {
+  for (int i = 1; i < argc; i++) {
+    string opt = argv[i];
+
+    if (opt == "-h" || opt == "-help") {
+      printUsage();
+      return 0;
+    }
+
+    // every other option takes a value
+    if (i + 1 >= argc) {
+      cout << "missing value of " << opt << '\n';
+      printUsage();
+      return 1;
+    }
+    string val = argv[++i];
+
+    if (opt == "-sdf") {
+      sdfFile = val;
+    } else if (opt == "-particles") {
+      particleFile = val;
+    } else if (opt == "-random") {
+      nOfRandom = atoi(val.c_str());
+    } else if (opt == "-steps") {
+      nOfSteps = atoi(val.c_str());
+    } else if (opt == "-dt") {
+      particleSystem.dt = atof(val.c_str());
+    } else if (opt == "-radius") {
+      particleSystem.contactRadius = atof(val.c_str());
+    } else if (opt == "-reorder") {
+      particleSystem.reorderInterval = atoi(val.c_str());
+    } else if (opt == "-sleep") {
+      particleSystem.sleepSteps = atoi(val.c_str());
+    } else if (opt == "-threads") {
+      nOfThreads = atoi(val.c_str());
+    } else if (opt == "-seed") {
+      seed = strtoul(val.c_str(), NULL, 10);
+    } else {
+      cout << "unknown option " << opt << '\n';
+      printUsage();
+      return 1;
+    }
+  }
+
+  ThreadPool pool(nOfThreads);
+
+  if (!initGrid(pool)) {
+    cout << "cannot read " << sdfFile << '\n';
+    return 1;
+  }
+
+  srand(seed);
+  if (nOfRandom > 0) {
+    randomPoints(particleSystem, nOfRandom);
+  } else {
+    loadPoints(particleSystem, particleFile);
+  }
+
+  int nOfPs = particleSystem.size();
+  if (nOfPs == 0) {
+    cout << "no particles" << '\n';
+    return 1;
+  }
+
+  float linesBefore = gridLinesPerBlock(particleSystem, grid);
+
+  auto t0 = chrono::steady_clock::now();
+
+  for (int s = 0; s < nOfSteps; s++) {
+    particleSystem.step(pyramid, pool);
+  }
+
+  auto t1 = chrono::steady_clock::now();
+  double sec = chrono::duration<double>(t1 - t0).count();
+
+  cout << nOfPs << " particles, " << nOfSteps << " steps, " << pool.size()
+       << " threads, " << pyramid.getNumLevels() << " levels, " << sec
+       << " s" << '\n';
+  cout << nOfSteps / sec << " steps/s, " << double(nOfPs) * nOfSteps / sec
+       << " particle-steps/s" << '\n';
+  cout << particleSystem.nOfActive << " awake particles" << '\n';
+  cout << particleSystem.nOfReorders << " reorders, grid cache lines per "
+       << PARTICLE_BLOCK << " particles: " << linesBefore << " -> "
+       << gridLinesPerBlock(particleSystem, grid) << '\n';
+
+  char hex[17];
+  snprintf(hex, sizeof(hex), "%016llx",
+           (unsigned long long)checksum(particleSystem));
+  cout << "checksum: " << hex << '\n';
+
+  return 0;
+}
+
+void printUsage() {
+  cout << "usage: runSimulation [options]" << '\n'
+       << "  -sdf <file>         sdf, binary if *.sdf (sdfBunnyBatty.txt)"
+       << '\n'
+       << "  -particles <file>   positions, one \"x y z\" per line"
+       << " (particles.txt)" << '\n'
+       << "  -random <n>         n random particles in the upper half of the grid"
+       << '\n'
+       << "  -steps <n>          # of steps (1000)" << '\n'
+       << "  -dt <dt>            time step (0.01)" << '\n'
+       << "  -radius <r>         contact radius of particles, 0 for none (0)"
+       << '\n'
+       << "  -reorder <k>        Morton reorder every k steps, 0 for never (0)"
+       << '\n'
+       << "  -sleep <k>          particles still for k steps sleep, 0 for never"
+       << " (0)" << '\n'
+       << "  -threads <n>        # of threads, 0 for all (0)" << '\n'
+       << "  -seed <n>           seed of velocities and masses (0)" << '\n';
+}
+
+// 64-bit FNV-1a of the bits of the final positions, in the order of ids
+uint64_t checksum(ParticleSystem &ps) {
+  uint64_t h = 14695981039346656037ull;
+  const vector<float> *arrays[3] = {&ps.px, &ps.py, &ps.pz};
+
+  int nOfPs = ps.size();
+  vector<int> byId(nOfPs);
+  for (int i = 0; i < nOfPs; i++) {
+    byId[ps.ids[i]] = i;
+  }
+
+  for (int a = 0; a < 3; a++) {
+    for (int k = 0; k < nOfPs; k++) {
+      uint32_t bits;
+      memcpy(&bits, &(*arrays[a])[byId[k]], sizeof(bits));
+
+      for (int b = 0; b < 4; b++) {
+        h ^= (bits >> (8 * b)) & 0xff;
+        h *= 1099511628211ull;
+      }
+    }
+  }
+
+  return h;
+}
+
+// Mean # of different cache lines of the grid read by a block of step()
+// Only the lower corner of the cell of each particle is counted.
+// A proxy of the cache misses of the sdf queries, lower is better.
+float gridLinesPerBlock(ParticleSystem &ps, Grid &g) {
+  int nOfPs = ps.size();
+  int nOfBlocks = 0;
+  double nOfLines = 0;
+  vector<size_t> lines;
+
+  for (int begin = 0; begin < nOfPs; begin += PARTICLE_BLOCK) {
+    int end = glm::min(begin + PARTICLE_BLOCK, nOfPs);
+    lines.clear();
+
+    for (int i = begin; i < end; i++) {
+      vec3 u = (ps.getPos(i) - g.origin) / g.cellSize;
+
+      if (!(u.x >= 0.f && u.x < g.nOfCells.x && u.y >= 0.f &&
+            u.y < g.nOfCells.y && u.z >= 0.f && u.z < g.nOfCells.z)) {
+        continue;
+      }
+
+      size_t offset = g.getOffset(ivec3(u));
+      lines.push_back(offset * sizeof(float) / 64);
+    }
+
+    sort(lines.begin(), lines.end());
+    nOfLines += unique(lines.begin(), lines.end()) - lines.begin();
+    nOfBlocks++;
+  }
+
+  return (nOfBlocks > 0) ? nOfLines / nOfBlocks : 0.f;
+}
+
+// Same as initGrid() of simulation.cpp
+bool initGrid(ThreadPool &pool) {
+  if (isBinarySdf(sdfFile)) {
+    // zero copy, samples are read from the mapped file
+    if (!mapSdf(grid, sdfMap, sdfFile)) {
+      return false;
+    }
+  } else {
+    readSdfBatty(grid, sdfFile, pool);
+  }
+
+  if (grid.size() == 0) {
+    return false;
+  }
+
+  // coarse levels written by createSdf -levels, or built here
+  int nOfLevels = 1;
+  if (isBinarySdf(sdfFile)) {
+    nOfLevels = mapSdfPyramid(pyramid, grid, levelMaps, sdfFile);
+  }
+
+  if (nOfLevels == 1) {
+    pyramid.build(grid, 4, pool);
+  }
+
+  return true;
+}
+
+// Same as loadPoints() of simulation.cpp
+void loadPoints(ParticleSystem &pars, const string fileName) {
+  // read point information from file
+  ifstream ifs(fileName);
+
+  while (ifs.peek() != EOF) {
+    float x, y, z;
+
+    ifs >> x;
+    ifs >> y;
+    ifs >> z;
+
+    // ignore '\n'
+    // otherwise, the last empty line will be read
+    ifs.ignore(1);
+
+    vec3 pos(x, y, z);
+    vec3 v(randf() - 0.5f, randf() - 0.5f, randf() - 0.5f);
+    float m = randf();
+
+    // relative to the grid origin
+    pos += grid.origin + vec3(0, 4.f, 0);
+
+    pars.add(pos, v, m);
+  }
+
+  ifs.close();
+}
+
+// n particles scattered over the xz extent of the grid,
+// in the upper half of the grid, so that they fall onto the mesh
+void randomPoints(ParticleSystem &pars, int n) {
+  vec3 extent = vec3(grid.nOfCells) * grid.cellSize;
+
+  for (int i = 0; i < n; i++) {
+    vec3 pos = grid.origin + vec3(randf() * extent.x,
+                                  extent.y * (0.5f + randf() * 0.5f),
+                                  randf() * extent.z);
+    vec3 v(randf() - 0.5f, randf() - 0.5f, randf() - 0.5f);
+    float m = randf();
+
+    pars.add(pos, v, m);
+  }
+}
+
+float randf() {
+  // [0, 1]
+  float f = static_cast<float>(rand()) / static_cast<float>(RAND_MAX);
+
+  return f;
+}
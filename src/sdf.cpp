@@ -1,5 +1,7 @@
 #include "sdf.h"
 
+#include <algorithm>
+
 // Given A, B, Q
 // Project Q on AB at P
 // Let P = vA + uB
@@ -218,8 +220,7 @@ float distPoint2Triangle(vec3 a, vec3 b, vec3 c, vec3 n, vec3 p) {
   float sign = (temp == 0) ? 1.f : (temp / abs(temp));
 
   // special case
-  float epsilon = 0.01f;
-  if (abs(temp) < epsilon) {
+  if (abs(temp) < SIGN_EPSILON) {
     sign = 1.f;
   }
 
@@ -228,6 +229,31 @@ float distPoint2Triangle(vec3 a, vec3 b, vec3 c, vec3 n, vec3 p) {
   return dist * sign;
 }
 
+// Merge a new signed distance into the current closest one
+// dist: the closest signed distance so far
+// temp: the signed distance to the next triangle
+// Triangles must be merged in the order of Mesh::faces
+// to get the same result as iterating all the faces
+float mergeDistance(float dist, float temp) {
+  float oldDist = dist;
+
+  // for general case
+  dist = (glm::abs(temp) < glm::abs(dist)) ? temp : dist;
+
+  // for a special case
+  float delta = abs(abs(temp) - abs(oldDist));
+  // if delta is less than some threshold
+  // we decide that temp is equal to dist
+  if (delta < TIE_EPSILON) {
+
+    // if dist will change its sign
+    // we keep dist at the positive one
+    dist = (temp > 0) ? temp : oldDist;
+  }
+
+  return dist;
+}
+
 // using world space position to calculate node hash
 // pay attention to the order of x, y, z
 // otherwise, a index error happens
@@ -243,9 +269,138 @@ int calCellHash(vec3 pos, ivec3 nOfCells, float cellSize) {
 
 //
 
+// Interleave the bits of idx, x in the lowest bit
+// Each component must be less than 1024.
+unsigned int mortonCode(ivec3 idx) {
+  unsigned int code = 0;
+
+  for (int bit = 0; bit < 10; bit++) {
+    code |= ((unsigned int)(idx.x >> bit) & 1u) << (3 * bit);
+    code |= ((unsigned int)(idx.y >> bit) & 1u) << (3 * bit + 1);
+    code |= ((unsigned int)(idx.z >> bit) & 1u) << (3 * bit + 2);
+  }
+
+  return code;
+}
+
 /* Member functions of Grid */
+// Set the grid parameters and fill all cells with value
+void Grid::init(vec3 gridOrigin, float size, ivec3 n, float value,
+                int newLayout) {
+  origin = gridOrigin;
+  cellSize = size;
+  nOfCells = n;
+
+  initLayout(newLayout);
+
+  sd.assign(getStorageSize(), value);
+  samples = sd.data();
+}
+
+// Set up the index of a layout, samples are not touched
+void Grid::initLayout(int newLayout) {
+  layout = newLayout;
+  brickOffsets.clear();
+
+  if (layout != GRID_BRICKED) {
+    nOfBricks = ivec3(0);
+    return;
+  }
+
+  nOfBricks = (nOfCells + BRICK_SIZE - 1) / BRICK_SIZE;
+  int nOfAll = nOfBricks.x * nOfBricks.y * nOfBricks.z;
+
+  // sort bricks by their Morton code,
+  // the rank of a brick decides where it is stored
+  vector<pair<unsigned int, int>> order(nOfAll);
+  for (int b = 0; b < nOfAll; b++) {
+    ivec3 bIdx(b % nOfBricks.x, (b / nOfBricks.x) % nOfBricks.y,
+               b / (nOfBricks.x * nOfBricks.y));
+    order[b] = make_pair(mortonCode(bIdx), b);
+  }
+  sort(order.begin(), order.end());
+
+  brickOffsets.resize(nOfAll);
+  for (int rank = 0; rank < nOfAll; rank++) {
+    brickOffsets[order[rank].second] = rank * BRICK_CELLS;
+  }
+}
+
+// Move the samples into another layout
+// A mapped grid gets its own copy of the samples.
+void Grid::setLayout(int newLayout) {
+  if (newLayout == layout) {
+    return;
+  }
+
+  Grid dst;
+  dst.init(origin, cellSize, nOfCells, 9999.f, newLayout);
+
+  for (int k = 0; k < nOfCells.z; k++) {
+    for (int j = 0; j < nOfCells.y; j++) {
+      for (int i = 0; i < nOfCells.x; i++) {
+        ivec3 idx(i, j, k);
+        dst.sd[dst.getOffset(idx)] = samples[getOffset(idx)];
+      }
+    }
+  }
+
+  sd.swap(dst.sd);
+  samples = sd.data();
+  layout = newLayout;
+  nOfBricks = dst.nOfBricks;
+  brickOffsets.swap(dst.brickOffsets);
+}
+
+// # of cells
+size_t Grid::size() { return size_t(nOfCells.x) * nOfCells.y * nOfCells.z; }
+
+// # of stored samples, bricks on the border are padded
+size_t Grid::getStorageSize() {
+  if (layout == GRID_BRICKED) {
+    return brickOffsets.size() * BRICK_CELLS;
+  }
+
+  return size();
+}
+
+int Grid::getHash(ivec3 idx) {
+  return idx.x + idx.y * nOfCells.x + idx.z * nOfCells.x * nOfCells.y;
+}
+
+// where the sample of a cell is stored
+int Grid::getOffset(ivec3 idx) {
+  if (layout == GRID_LINEAR) {
+    return getHash(idx);
+  }
+
+  // brick, and cell inside the brick
+  int bx = idx.x >> BRICK_LOG2, lx = idx.x & (BRICK_SIZE - 1);
+  int by = idx.y >> BRICK_LOG2, ly = idx.y & (BRICK_SIZE - 1);
+  int bz = idx.z >> BRICK_LOG2, lz = idx.z & (BRICK_SIZE - 1);
+
+  int brick = bx + by * nOfBricks.x + bz * nOfBricks.x * nOfBricks.y;
+
+  return brickOffsets[brick] + lx + (ly << BRICK_LOG2) +
+         (lz << (2 * BRICK_LOG2));
+}
+
+ivec3 Grid::getIdx(int hash) {
+  int nxy = nOfCells.x * nOfCells.y;
+
+  return ivec3(hash % nOfCells.x, (hash % nxy) / nOfCells.x, hash / nxy);
+}
+
+// position of a cell in world space
+vec3 Grid::getPos(ivec3 idx) { return vec3(idx) * cellSize + origin; }
+
+vec3 Grid::getPos(int hash) { return getPos(getIdx(hash)); }
+
 // calculate a cell's index (or hash) by a given point
 int Grid::calCellHash(vec3 pos) {
+  // transform to the reference frame of the grid
+  pos -= origin;
+
   int hx = int(floor(pos.x / cellSize));
   int hy = int(floor(pos.y / cellSize) * nOfCells.x);
   int hz = int(floor(pos.z / cellSize) * nOfCells.x * nOfCells.y);
@@ -254,7 +409,13 @@ int Grid::calCellHash(vec3 pos) {
 }
 
 // retrieve signed distance by cell's hash
-float Grid::getDistance(int hash) { return cells[hash].sd; }
+float Grid::getDistance(int hash) {
+  if (layout == GRID_LINEAR) {
+    return samples[hash];
+  }
+
+  return samples[getOffset(getIdx(hash))];
+}
 
 // retrieve signed distance by point position
 float Grid::getDistance(vec3 p) {
@@ -264,7 +425,6 @@ float Grid::getDistance(vec3 p) {
   // restriction
   ivec3 idx = floor(p / cellSize);
 
-  // note that grid origin is set to world origin (0, 0, 0)
   if (idx.x < 0 || idx.x > nOfCells.x - 1) {
     return 9999.f;
   } else if (idx.y < 0 || idx.y > nOfCells.y - 1) {
@@ -272,18 +432,68 @@ float Grid::getDistance(vec3 p) {
   } else if (idx.z < 0 || idx.z > nOfCells.z - 1) {
     return 9999.f;
   } else {
-    int hash = calCellHash(p);
-    return cells[hash].sd;
+    return samples[getOffset(idx)];
   }
 }
 
+// Trilinear signed distance and its analytic gradient at p
+// The 8 corner samples of the cell containing p are read once.
+// grad is the gradient of the distance, i.e. it points away from the
+// surface and is not normalized.
+// Outside the grid, return 9999 and a zero gradient like getDistance().
+float Grid::getDistanceGradient(vec3 p, vec3 &grad) {
+  // transform to grid space
+  vec3 u = (p - origin) / cellSize;
+
+  // written as "not inside" so that NaN is outside
+  if (!(u.x >= 0.f && u.x < nOfCells.x && u.y >= 0.f && u.y < nOfCells.y &&
+        u.z >= 0.f && u.z < nOfCells.z)) {
+    grad = vec3(0);
+    return 9999.f;
+  }
+
+  // lower corner, the last layer of cells uses the cell below it
+  ivec3 i0 = glm::max(glm::min(ivec3(u), nOfCells - 2), ivec3(0));
+  ivec3 i1 = glm::min(i0 + 1, nOfCells - 1);
+  vec3 t = glm::clamp(u - vec3(i0), vec3(0), vec3(1));
+
+  float d000 = samples[getOffset(ivec3(i0.x, i0.y, i0.z))];
+  float d100 = samples[getOffset(ivec3(i1.x, i0.y, i0.z))];
+  float d010 = samples[getOffset(ivec3(i0.x, i1.y, i0.z))];
+  float d110 = samples[getOffset(ivec3(i1.x, i1.y, i0.z))];
+  float d001 = samples[getOffset(ivec3(i0.x, i0.y, i1.z))];
+  float d101 = samples[getOffset(ivec3(i1.x, i0.y, i1.z))];
+  float d011 = samples[getOffset(ivec3(i0.x, i1.y, i1.z))];
+  float d111 = samples[getOffset(ivec3(i1.x, i1.y, i1.z))];
+
+  // along x
+  float d00 = d000 + t.x * (d100 - d000);
+  float d10 = d010 + t.x * (d110 - d010);
+  float d01 = d001 + t.x * (d101 - d001);
+  float d11 = d011 + t.x * (d111 - d011);
+
+  // along y
+  float d0 = d00 + t.y * (d10 - d00);
+  float d1 = d01 + t.y * (d11 - d01);
+
+  // derivatives of the interpolant in grid space
+  float gx0 = (d100 - d000) + t.y * ((d110 - d010) - (d100 - d000));
+  float gx1 = (d101 - d001) + t.y * ((d111 - d011) - (d101 - d001));
+
+  grad.x = gx0 + t.z * (gx1 - gx0);
+  grad.y = (d10 - d00) + t.z * ((d11 - d01) - (d10 - d00));
+  grad.z = d1 - d0;
+  grad /= cellSize;
+
+  return d0 + t.z * (d1 - d0);
+}
+
 // retrieve gradient of a point p
 vec3 Grid::getGradient2(vec3 p) {
   vec3 grad;
 
-  // currently, grid origin is set to world origin (0, 0, 0)
-  // if not, be careful to transform p to reference frame
-  vec3 pref = p;
+  // transform to the reference frame of the grid
+  vec3 pref = p - origin;
 
   // calculate alpha (or the "normalized" position inside a cell)
   vec3 pCellPos = pref / cellSize;
@@ -319,10 +529,8 @@ vec3 Grid::getGradient2(vec3 p) {
   return glm::normalize(-grad);
 }
 
+// p is in world space, as getDistance() transforms it
 vec3 Grid::getGradient(vec3 p) {
-  // transform to the reference frame of the grid
-  p -= origin;
-
   float gx = getDistance(vec3(p.x + cellSize, p.y, p.z)) -
              getDistance(vec3(p.x - cellSize, p.y, p.z));
 
@@ -334,3 +542,26 @@ vec3 Grid::getGradient(vec3 p) {
 
   return normalize(-vec3(gx, gy, gz));
 }
+
+Grid::Grid(const Grid &other) { *this = other; }
+
+// A copy of an owning grid points to its own samples,
+// a copy of a mapped grid shares the mapping
+Grid &Grid::operator=(const Grid &other) {
+  if (this == &other) {
+    return *this;
+  }
+
+  sd = other.sd;
+  origin = other.origin;
+  cellSize = other.cellSize;
+  nOfCells = other.nOfCells;
+  layout = other.layout;
+  nOfBricks = other.nOfBricks;
+  brickOffsets = other.brickOffsets;
+
+  bool owning = (other.samples == other.sd.data());
+  samples = owning ? sd.data() : other.samples;
+
+  return *this;
+}
@@ -0,0 +1,847 @@
+#include "sdfGen.h"
+
+#include <algorithm>
+
+// Compute the exact signed distance of cells in [startIdx, endIdx)
+// Rows of cells (fixed y and z) are handed to the thread pool.
+// A cell only depends on its own position,
+// so the result is the same for any # of threads.
+// coherent: rows of a task are walked as a serpentine, and each query
+// is seeded by the previous cell Q, i.e. its closest triangle and
+// the bound |d(Q)| + |P - Q|. The result is the same either way.
+void generateSdfExact(Grid &grid, Bvh &bvh, ThreadPool &pool, ivec3 startIdx,
+                      ivec3 endIdx, bool coherent) {
+  ivec3 nOfCells = grid.nOfCells;
+  ivec3 range = endIdx - startIdx;
+  int nOfRows = range.y * range.z;
+
+  // several chunks per thread, so that idle threads can steal
+  int grain = glm::max(1, nOfRows / (pool.size() * 8));
+
+  pool.parallelFor(0, nOfRows, grain, [&](int rowBegin, int rowEnd) {
+    // the previous cell of this task
+    vec3 Q(0);
+    float distQ = 9999.f;
+    int closest = -1;
+
+    for (int row = rowBegin; row < rowEnd; row++) {
+      int iy = startIdx.y + row % range.y;
+      int iz = startIdx.z + row / range.y;
+
+      // odd rows backwards, so the next cell is always close
+      bool backwards = coherent && (row % 2 == 1);
+
+      for (int i = 0; i < range.x; i++) {
+        int ix = backwards ? endIdx.x - 1 - i : startIdx.x + i;
+
+        // same as the cell position in initGrid()
+        vec3 P = vec3(ix, iy, iz) * grid.cellSize + grid.origin;
+
+        // closest signed distance to the mesh
+        float dist;
+
+        if (coherent) {
+          float bound = glm::min(abs(distQ) + length(P - Q), 9999.f);
+          dist = bvh.getDistance(P, bound, closest);
+          Q = P;
+          distQ = dist;
+        } else {
+          dist = bvh.getDistance(P);
+        }
+
+        // write dist into grid
+        int hash = ix + iy * nOfCells.x + iz * nOfCells.x * nOfCells.y;
+        grid.sd[hash] = dist;
+      } // end x direction
+    }   // end rows
+  });
+}
+
+// One sweep of the far field in the direction (dx, dy, dz)
+// A cell takes the closest triangle of its upwind neighbours
+// if that triangle is closer than its own.
+static void sweep(Grid &grid, TriangleSet &tris, vector<int> &closest,
+                  vector<char> &frozen, int dx, int dy, int dz) {
+  ivec3 n = grid.nOfCells;
+
+  int x0 = (dx > 0) ? 0 : n.x - 1;
+  int y0 = (dy > 0) ? 0 : n.y - 1;
+  int z0 = (dz > 0) ? 0 : n.z - 1;
+
+  for (int k = 0, iz = z0; k < n.z; k++, iz += dz) {
+    for (int j = 0, iy = y0; j < n.y; j++, iy += dy) {
+      for (int i = 0, ix = x0; i < n.x; i++, ix += dx) {
+        int hash = ix + iy * n.x + iz * n.x * n.y;
+
+        if (frozen[hash]) {
+          continue;
+        }
+
+        vec3 P = vec3(ix, iy, iz) * grid.cellSize + grid.origin;
+        float &sd = grid.sd[hash];
+
+        // the 7 neighbours behind this cell in the sweep direction
+        for (int o = 1; o < 8; o++) {
+          int nx = ix - ((o & 1) ? dx : 0);
+          int ny = iy - ((o & 2) ? dy : 0);
+          int nz = iz - ((o & 4) ? dz : 0);
+
+          if (nx < 0 || nx >= n.x || ny < 0 || ny >= n.y || nz < 0 ||
+              nz >= n.z) {
+            continue;
+          }
+
+          int t = closest[nx + ny * n.x + nz * n.x * n.y];
+
+          if (t < 0 || t == closest[hash]) {
+            continue;
+          }
+
+          float temp = distPoint2Triangle(tris, t, P);
+          float merged = mergeDistance(sd, temp);
+
+          if (merged != sd) {
+            sd = merged;
+            closest[hash] = t;
+          }
+        } // end neighbours
+      }   // end x direction
+    }     // end y direction
+  }       // end z direction
+}
+
+// Triangles of each z-slab of cells, a counting sort by slab
+// Triangle t covers the slabs [lo[t].z, hi[t].z], none if lo > hi.
+// The triangles of slab z are idxs[starts[z], starts[z + 1]),
+// in increasing order.
+static void bucketBySlab(vector<ivec3> &lo, vector<ivec3> &hi, int nz,
+                         vector<int> &starts, vector<int> &idxs) {
+  int nOfTris = lo.size();
+
+  starts.assign(nz + 1, 0);
+  for (int t = 0; t < nOfTris; t++) {
+    for (int iz = lo[t].z; iz <= hi[t].z; iz++) {
+      starts[iz + 1]++;
+    }
+  }
+
+  for (int iz = 0; iz < nz; iz++) {
+    starts[iz + 1] += starts[iz];
+  }
+
+  vector<int> next(starts.begin(), starts.end() - 1);
+  idxs.resize(starts[nz]);
+
+  for (int t = 0; t < nOfTris; t++) {
+    for (int iz = lo[t].z; iz <= hi[t].z; iz++) {
+      idxs[next[iz]++] = t;
+    }
+  }
+}
+
+// Exact distance in a band around the surface,
+// then fast sweeping for the rest of the grid.
+// tris must be in the order of Mesh::faces, so that ties are merged
+// in the same order as generateSdfExact().
+// band: half width of the band, in # of cells
+//
+// Each triangle only touches cells inside its aabb expanded by the band,
+// so the cost is O(tris * band^3 + cells) instead of O(tris * cells).
+// The far field is filled by sweeping the closest triangle of each cell
+// over the grid in 8 directions, the closest point version of
+// the fast sweeping method for the Eikonal equation |grad(d)| = 1.
+// Its sign follows the same rule as the exact distance.
+void generateSdfNarrowBand(Grid &grid, TriangleSet &tris, ThreadPool &pool,
+                           int band) {
+  ivec3 n = grid.nOfCells;
+  int nOfCells = n.x * n.y * n.z;
+  float bandWidth = band * grid.cellSize;
+
+  // closest triangle of each cell, -1 if unknown
+  vector<int> closest(nOfCells, -1);
+
+  /* cells covered by each triangle */
+  vector<ivec3> lo(tris.nOfTris), hi(tris.nOfTris);
+
+  for (int t = 0; t < tris.nOfTris; t++) {
+    vec3 A(tris.ax[t], tris.ay[t], tris.az[t]);
+    vec3 B(tris.bx[t], tris.by[t], tris.bz[t]);
+    vec3 C(tris.cx[t], tris.cy[t], tris.cz[t]);
+
+    vec3 boxMin = glm::min(glm::min(A, B), C) - vec3(bandWidth);
+    vec3 boxMax = glm::max(glm::max(A, B), C) + vec3(bandWidth);
+
+    lo[t] = ivec3(ceil((boxMin - grid.origin) / grid.cellSize));
+    hi[t] = ivec3(floor((boxMax - grid.origin) / grid.cellSize));
+
+    lo[t] = glm::max(lo[t], ivec3(0));
+    hi[t] = glm::min(hi[t], n - 1);
+  }
+
+  vector<int> slabStarts, slabTris;
+  bucketBySlab(lo, hi, n.z, slabStarts, slabTris);
+
+  /* exact distance in the band */
+  // a z-slab belongs to one task, and its triangles are merged
+  // in face order, so the result is the same for any # of threads
+  pool.parallelFor(0, n.z, 1, [&](int zBegin, int zEnd) {
+    for (int iz = zBegin; iz < zEnd; iz++) {
+      for (int k = slabStarts[iz]; k < slabStarts[iz + 1]; k++) {
+        int t = slabTris[k];
+
+        for (int iy = lo[t].y; iy <= hi[t].y; iy++) {
+          for (int ix = lo[t].x; ix <= hi[t].x; ix++) {
+            int hash = ix + iy * n.x + iz * n.x * n.y;
+            vec3 P = vec3(ix, iy, iz) * grid.cellSize + grid.origin;
+
+            float &sd = grid.sd[hash];
+            float temp = distPoint2Triangle(tris, t, P);
+            float merged = mergeDistance(sd, temp);
+
+            if (merged != sd) {
+              sd = merged;
+              closest[hash] = t;
+            }
+          } // end x direction
+        }   // end y direction
+      }     // end iterate triangles
+    }       // end z direction
+  });
+
+  // a cell closer than bandWidth has seen all triangles within bandWidth,
+  // so its distance is already exact
+  vector<char> frozen(nOfCells);
+  for (int i = 0; i < nOfCells; i++) {
+    frozen[i] = (closest[i] >= 0 && abs(grid.sd[i]) <= bandWidth);
+  }
+
+  /* fast sweeping in the far field */
+  // two rounds of the 8 sweep directions, as in SDFGen
+  for (int round = 0; round < 2; round++) {
+    for (int dir = 0; dir < 8; dir++) {
+      int dx = (dir & 1) ? -1 : 1;
+      int dy = (dir & 2) ? -1 : 1;
+      int dz = (dir & 4) ? -1 : 1;
+
+      sweep(grid, tris, closest, frozen, dx, dy, dz);
+    }
+  }
+}
+
+// Orientation of the 2D segment from (0, 0) to (y1, z1) against (y2, z2)
+// twiceArea: twice the signed area of the triangle (0, p1, p2)
+// A zero area is broken by comparing coordinates,
+// so that a point on a shared edge belongs to exactly one triangle
+// (same tie breaking as SDFGen).
+static int orientation(double y1, double z1, double y2, double z2,
+                       double &twiceArea) {
+  twiceArea = z1 * y2 - y1 * z2;
+
+  if (twiceArea > 0) {
+    return 1;
+  } else if (twiceArea < 0) {
+    return -1;
+  } else if (z2 > z1) {
+    return 1;
+  } else if (z2 < z1) {
+    return -1;
+  } else if (y1 > y2) {
+    return 1;
+  } else if (y1 < y2) {
+    return -1;
+  } else {
+    return 0;
+  }
+}
+
+// Check whether (y0, z0) is inside the 2D triangle p1 p2 p3
+// If so, return its barycentric coordinate in (a, b, c)
+static bool pointInTriangle2d(double y0, double z0, double y1, double z1,
+                              double y2, double z2, double y3, double z3,
+                              double &a, double &b, double &c) {
+  y1 -= y0;
+  y2 -= y0;
+  y3 -= y0;
+  z1 -= z0;
+  z2 -= z0;
+  z3 -= z0;
+
+  int signA = orientation(y2, z2, y3, z3, a);
+  if (signA == 0) {
+    return false;
+  }
+
+  int signB = orientation(y3, z3, y1, z1, b);
+  if (signB != signA) {
+    return false;
+  }
+
+  int signC = orientation(y1, z1, y2, z2, c);
+  if (signC != signA) {
+    return false;
+  }
+
+  double sum = a + b + c;
+  a /= sum;
+  b /= sum;
+  c /= sum;
+
+  return true;
+}
+
+// Classify each cell as inside or outside the mesh by ray parity
+// Each triangle is rasterized on the grid rows (lines along x)
+// passing through its yz projection, and flips the parity of
+// the first cell beyond the crossing. A prefix xor along each row
+// then gives the parity of crossings on the ray from -x to the cell.
+// Cost is O(cells + tris), and it does not depend on normals.
+// inside[hash] is 1 if the cell is inside the mesh.
+void computeInsideParity(Grid &grid, TriangleSet &tris, ThreadPool &pool,
+                         vector<char> &inside) {
+  ivec3 n = grid.nOfCells;
+  float h = grid.cellSize;
+  vec3 o = grid.origin;
+
+  inside.assign(n.x * n.y * n.z, 0);
+
+  // rows crossed by each triangle
+  vector<ivec3> lo(tris.nOfTris), hi(tris.nOfTris);
+
+  for (int t = 0; t < tris.nOfTris; t++) {
+    vec3 A(tris.ax[t], tris.ay[t], tris.az[t]);
+    vec3 B(tris.bx[t], tris.by[t], tris.bz[t]);
+    vec3 C(tris.cx[t], tris.cy[t], tris.cz[t]);
+
+    lo[t] = ivec3(ceil((glm::min(glm::min(A, B), C) - o) / h));
+    hi[t] = ivec3(floor((glm::max(glm::max(A, B), C) - o) / h));
+
+    lo[t] = glm::max(lo[t], ivec3(0));
+    hi[t] = glm::min(hi[t], n - 1);
+  }
+
+  vector<int> slabStarts, slabTris;
+  bucketBySlab(lo, hi, n.z, slabStarts, slabTris);
+
+  // a z-slab of rows belongs to one task, the parity of a cell
+  // does not depend on the order of the triangles
+  pool.parallelFor(0, n.z, 1, [&](int zBegin, int zEnd) {
+    for (int iz = zBegin; iz < zEnd; iz++) {
+      for (int k = slabStarts[iz]; k < slabStarts[iz + 1]; k++) {
+        int t = slabTris[k];
+
+        // vertices in grid space
+        // note: a vertex shared by several triangles must map to
+        // the same point, otherwise the tie breaking fails
+        double ax = (double(tris.ax[t]) - o.x) / h;
+        double ay = (double(tris.ay[t]) - o.y) / h;
+        double az = (double(tris.az[t]) - o.z) / h;
+        double bx = (double(tris.bx[t]) - o.x) / h;
+        double by = (double(tris.by[t]) - o.y) / h;
+        double bz = (double(tris.bz[t]) - o.z) / h;
+        double cx = (double(tris.cx[t]) - o.x) / h;
+        double cy = (double(tris.cy[t]) - o.y) / h;
+        double cz = (double(tris.cz[t]) - o.z) / h;
+
+        for (int iy = lo[t].y; iy <= hi[t].y; iy++) {
+          double a, b, c;
+
+          if (!pointInTriangle2d(iy, iz, ay, az, by, bz, cy, cz, a, b, c)) {
+            continue;
+          }
+
+          // where the row crosses the triangle
+          double x = a * ax + b * bx + c * cx;
+
+          // first cell beyond the crossing
+          int ix = int(std::floor(x)) + 1;
+          ix = glm::max(ix, 0);
+
+          if (ix < n.x) {
+            inside[ix + iy * n.x + iz * n.x * n.y] ^= 1;
+          }
+        } // end y direction
+      }   // end iterate triangles
+    }     // end z direction
+
+    // accumulate the parity along each row
+    for (int iz = zBegin; iz < zEnd; iz++) {
+      for (int iy = 0; iy < n.y; iy++) {
+        int row = iy * n.x + iz * n.x * n.y;
+
+        for (int ix = 1; ix < n.x; ix++) {
+          inside[row + ix] ^= inside[row + ix - 1];
+        }
+      }
+    }
+  });
+}
+
+// Classify each cell as inside or outside the mesh by its winding number
+// Cells are independent, so rows are handed to the thread pool.
+void computeInsideWinding(Grid &grid, WindingNumber &wn, ThreadPool &pool,
+                          vector<char> &inside) {
+  ivec3 n = grid.nOfCells;
+  int nOfRows = n.y * n.z;
+
+  inside.assign(n.x * n.y * n.z, 0);
+
+  int grain = glm::max(1, nOfRows / (pool.size() * 8));
+
+  pool.parallelFor(0, nOfRows, grain, [&](int rowBegin, int rowEnd) {
+    for (int row = rowBegin; row < rowEnd; row++) {
+      int iy = row % n.y;
+      int iz = row / n.y;
+
+      for (int ix = 0; ix < n.x; ix++) {
+        vec3 P = vec3(ix, iy, iz) * grid.cellSize + grid.origin;
+
+        inside[ix + row * n.x] = (wn.getWinding(P) > 0.5f);
+      }
+    }
+  });
+}
+
+// Replace the sign of each cell by the inside/outside classification
+void applySign(Grid &grid, vector<char> &inside) {
+  for (size_t i = 0; i < grid.sd.size(); i++) {
+    float d = abs(grid.sd[i]);
+
+    grid.sd[i] = inside[i] ? -d : d;
+  }
+}
+
+// Inside or outside of P, by the winding number if wn is given,
+// otherwise by the sign of the closest triangle
+static bool isInside(Bvh &bvh, WindingNumber *wn, vec3 P) {
+  if (wn) {
+    return wn->getWinding(P) > 0.5f;
+  }
+
+  return bvh.getDistance(P) < 0.f;
+}
+
+// Generate a sparse sdf without allocating the dense grid
+// 1. a leaf is added if a triangle may be closer than band cells
+//    to any of its cells, tested by the aabb and the plane of the triangle
+// 2. every cell of a leaf gets the exact distance from the bvh
+// 3. every other child of a node, and every node of the range without
+//    leaves, becomes a tile of +-band cells by the sign at its center
+// No cell outside the leaves is closer than band cells to the mesh,
+// so the tiles are conservative bounds of the distance.
+// Leaves are added in a fixed order and cells are independent,
+// so the result is the same for any # of threads.
+void generateSdfSparse(SparseGrid &grid, Bvh &bvh, WindingNumber *wn,
+                       ThreadPool &pool, int band) {
+  TriangleSet &tris = bvh.tris;
+  float h = grid.cellSize;
+  float bandWidth = band * h;
+
+  // keep the range of the grid, replace its contents
+  grid.init(grid.origin, h, grid.nOfCells, bandWidth);
+
+  ivec3 maxLeaf((grid.nOfCells - 1) / BRICK_SIZE);
+
+  // distance from the center of a leaf to its farthest cell
+  float leafRadius = 0.5f * (BRICK_SIZE - 1) * h * sqrt(3.f);
+
+  /* 1. leaves near each triangle */
+  int nOfChunks = glm::max(1, glm::min(tris.nOfTris, pool.size() * 8));
+  vector<vector<ivec3>> chunkLeaves(nOfChunks);
+
+  pool.parallelFor(0, nOfChunks, 1, [&](int cBegin, int cEnd) {
+    for (int c = cBegin; c < cEnd; c++) {
+      vector<ivec3> &leaves = chunkLeaves[c];
+      int tBegin = int(int64_t(tris.nOfTris) * c / nOfChunks);
+      int tEnd = int(int64_t(tris.nOfTris) * (c + 1) / nOfChunks);
+
+      for (int t = tBegin; t < tEnd; t++) {
+        vec3 A(tris.ax[t], tris.ay[t], tris.az[t]);
+        vec3 B(tris.bx[t], tris.by[t], tris.bz[t]);
+        vec3 C(tris.cx[t], tris.cy[t], tris.cz[t]);
+
+        vec3 n = cross(B - A, C - A);
+        float len = length(n);
+        n = (len > 0.f) ? n / len : vec3(0);
+
+        vec3 boxMin = glm::min(glm::min(A, B), C) - vec3(bandWidth);
+        vec3 boxMax = glm::max(glm::max(A, B), C) + vec3(bandWidth);
+
+        ivec3 lo = ivec3(floor((boxMin - grid.origin) / h)) / BRICK_SIZE;
+        ivec3 hi = ivec3(floor((boxMax - grid.origin) / h)) / BRICK_SIZE;
+        lo = glm::clamp(lo, ivec3(0), maxLeaf);
+        hi = glm::clamp(hi, ivec3(0), maxLeaf);
+
+        for (int lz = lo.z; lz <= hi.z; lz++) {
+          for (int ly = lo.y; ly <= hi.y; ly++) {
+            for (int lx = lo.x; lx <= hi.x; lx++) {
+              ivec3 leafIdx(lx, ly, lz);
+              vec3 center =
+                  grid.getPos(leafIdx * BRICK_SIZE) + 0.5f * (BRICK_SIZE - 1) * h;
+
+              // a large triangle only touches the leaves along its plane
+              if (abs(dot(center - A, n)) <= bandWidth + leafRadius) {
+                leaves.push_back(leafIdx);
+              }
+            }
+          }
+        }
+      } // end iterate triangles
+    }
+  });
+
+  // add the leaves in the order of their key
+  vector<ivec3> leaves;
+  for (int c = 0; c < nOfChunks; c++) {
+    leaves.insert(leaves.end(), chunkLeaves[c].begin(), chunkLeaves[c].end());
+    vector<ivec3>().swap(chunkLeaves[c]);
+  }
+
+  auto byKey = [](ivec3 a, ivec3 b) { return sparseKey(a) < sparseKey(b); };
+  auto sameKey = [](ivec3 a, ivec3 b) { return sparseKey(a) == sparseKey(b); };
+  sort(leaves.begin(), leaves.end(), byKey);
+  leaves.erase(unique(leaves.begin(), leaves.end(), sameKey), leaves.end());
+
+  for (size_t i = 0; i < leaves.size(); i++) {
+    grid.addLeaf(leaves[i]);
+  }
+
+  /* 2. exact distance of the cells of each leaf */
+  int nOfLeaves = grid.leafIdxs.size();
+
+  pool.parallelFor(0, nOfLeaves, 16, [&](int leafBegin, int leafEnd) {
+    for (int leaf = leafBegin; leaf < leafEnd; leaf++) {
+      float *samples = &grid.leafSamples[size_t(leaf) * BRICK_CELLS];
+      ivec3 first = grid.leafIdxs[leaf] * BRICK_SIZE;
+
+      for (int c = 0; c < BRICK_CELLS; c++) {
+        ivec3 idx = first + ivec3(c & (BRICK_SIZE - 1),
+                                  (c >> BRICK_LOG2) & (BRICK_SIZE - 1),
+                                  c >> (2 * BRICK_LOG2));
+
+        // cells out of the grid keep the tile value
+        if (idx.x >= grid.nOfCells.x || idx.y >= grid.nOfCells.y ||
+            idx.z >= grid.nOfCells.z) {
+          continue;
+        }
+
+        vec3 P = grid.getPos(idx);
+        float dist = bvh.getDistance(P);
+
+        if (wn) {
+          dist = isInside(bvh, wn, P) ? -abs(dist) : abs(dist);
+        }
+        samples[c] = dist;
+      }
+    }
+  });
+
+  /* 3. tiles */
+  int nOfNodes = grid.nodeIdxs.size();
+
+  pool.parallelFor(0, nOfNodes, 1, [&](int nodeBegin, int nodeEnd) {
+    for (int node = nodeBegin; node < nodeEnd; node++) {
+      ivec3 firstLeaf = grid.nodeIdxs[node] * SPARSE_NODE_SIZE;
+
+      for (int c = 0; c < SPARSE_NODE_CHILDREN; c++) {
+        size_t child = size_t(node) * SPARSE_NODE_CHILDREN + c;
+
+        if (grid.nodeChildren[child] >= 0) {
+          continue;
+        }
+
+        ivec3 leafIdx = firstLeaf + ivec3(c & (SPARSE_NODE_SIZE - 1),
+                                          (c >> SPARSE_NODE_LOG2) &
+                                              (SPARSE_NODE_SIZE - 1),
+                                          c >> (2 * SPARSE_NODE_LOG2));
+        vec3 center =
+            grid.getPos(leafIdx * BRICK_SIZE) + 0.5f * (BRICK_SIZE - 1) * h;
+
+        grid.nodeTiles[child] =
+            isInside(bvh, wn, center) ? -bandWidth : bandWidth;
+      }
+    }
+  });
+
+  // nodes of the grid range without any leaf
+  ivec3 maxNode = maxLeaf / SPARSE_NODE_SIZE;
+  vector<ivec3> emptyNodes;
+
+  for (int nz = 0; nz <= maxNode.z; nz++) {
+    for (int ny = 0; ny <= maxNode.y; ny++) {
+      for (int nx = 0; nx <= maxNode.x; nx++) {
+        ivec3 nodeIdx(nx, ny, nz);
+
+        if (grid.root.count(sparseKey(nodeIdx)) == 0) {
+          emptyNodes.push_back(nodeIdx);
+        }
+      }
+    }
+  }
+
+  int nOfEmpty = emptyNodes.size();
+  vector<char> inside(nOfEmpty);
+  float nodeHalf = 0.5f * (BRICK_SIZE * SPARSE_NODE_SIZE - 1) * h;
+
+  pool.parallelFor(0, nOfEmpty, 1, [&](int begin, int end) {
+    for (int i = begin; i < end; i++) {
+      ivec3 first = emptyNodes[i] * (BRICK_SIZE * SPARSE_NODE_SIZE);
+      inside[i] = isInside(bvh, wn, grid.getPos(first) + nodeHalf);
+    }
+  });
+
+  for (int i = 0; i < nOfEmpty; i++) {
+    grid.setRootTile(emptyNodes[i], inside[i] ? -bandWidth : bandWidth);
+  }
+}
+
+// Trilinear interpolation of the 8 corners of a cell at t in [0, 1]^3
+static float trilinear(const float d[8], vec3 t) {
+  float d00 = d[0] + t.x * (d[1] - d[0]);
+  float d10 = d[2] + t.x * (d[3] - d[2]);
+  float d01 = d[4] + t.x * (d[5] - d[4]);
+  float d11 = d[6] + t.x * (d[7] - d[6]);
+
+  float d0 = d00 + t.y * (d10 - d00);
+  float d1 = d01 + t.y * (d11 - d01);
+
+  return d0 + t.z * (d1 - d0);
+}
+
+// Build an adaptive distance field in the root cube of adf
+// adf.origin, size, maxDepth, tolerance and maxDistance must be set.
+// The octree is refined level by level. For each cell of a level,
+// the exact distance is computed on the 3x3x3 lattice of its half
+// cells, and the cell is split if the trilinear interpolation of its
+// corners misses any of them by more than the tolerance. The lattice
+// gives the corners of the 8 children, so no point is computed twice
+// within a cell. Cells of a level are independent and children are
+// added in order, so the result is the same for any # of threads.
+void generateAdf(Adf &adf, Bvh &bvh, WindingNumber *wn, ThreadPool &pool) {
+  auto exact = [&](vec3 P) {
+    float dist = bvh.getDistance(P);
+
+    if (wn) {
+      dist = isInside(bvh, wn, P) ? -abs(dist) : abs(dist);
+    }
+
+    return dist;
+  };
+
+  adf.nodes.clear();
+
+  AdfNode root;
+  root.children = -1;
+  for (int c = 0; c < 8; c++) {
+    vec3 corner((c & 1), (c >> 1) & 1, (c >> 2) & 1);
+    root.d[c] = exact(adf.origin + corner * adf.size);
+  }
+  adf.nodes.push_back(root);
+
+  // nodes of the current level and their lower corners
+  vector<int> level(1, 0);
+  vector<vec3> levelMin(1, adf.origin);
+  float cellSize = adf.size;
+
+  for (int depth = 0; depth < adf.maxDepth && !level.empty(); depth++) {
+    int nOfCells = level.size();
+    float half = 0.5f * cellSize;
+
+    // lattice[27 * i + x + 3 * y + 9 * z] of the i-th cell
+    vector<float> lattice(27 * size_t(nOfCells));
+    vector<char> split(nOfCells);
+
+    int grain = glm::max(1, nOfCells / (pool.size() * 8));
+
+    pool.parallelFor(0, nOfCells, grain, [&](int begin, int end) {
+      for (int i = begin; i < end; i++) {
+        const float *d = adf.nodes[level[i]].d;
+        float *L = &lattice[27 * size_t(i)];
+        float maxError = 0.f;
+
+        for (int z = 0; z < 3; z++) {
+          for (int y = 0; y < 3; y++) {
+            for (int x = 0; x < 3; x++) {
+              float &l = L[x + 3 * y + 9 * z];
+
+              // corners are known
+              if (x % 2 == 0 && y % 2 == 0 && z % 2 == 0) {
+                l = d[x / 2 + y + 2 * z];
+                continue;
+              }
+
+              l = exact(levelMin[i] + vec3(x, y, z) * half);
+
+              float interp = trilinear(d, vec3(x, y, z) * 0.5f);
+              maxError = glm::max(maxError, abs(l - interp));
+            }
+          }
+        }
+
+        // 1-Lipschitz: no point of the cell is closer than this
+        float nearest = abs(L[13]) - half * sqrt(3.f);
+
+        split[i] = (maxError > adf.tolerance && nearest <= adf.maxDistance);
+      }
+    });
+
+    /* children of the split cells */
+    vector<int> nextLevel;
+    vector<vec3> nextMin;
+
+    for (int i = 0; i < nOfCells; i++) {
+      if (!split[i]) {
+        continue;
+      }
+
+      const float *L = &lattice[27 * size_t(i)];
+      int first = adf.nodes.size();
+      adf.nodes[level[i]].children = first;
+
+      for (int c = 0; c < 8; c++) {
+        int cx = c & 1, cy = (c >> 1) & 1, cz = (c >> 2) & 1;
+
+        AdfNode child;
+        child.children = -1;
+        for (int k = 0; k < 8; k++) {
+          int x = cx + (k & 1), y = cy + ((k >> 1) & 1), z = cz + (k >> 2);
+          child.d[k] = L[x + 3 * y + 9 * z];
+        }
+
+        adf.nodes.push_back(child);
+        nextLevel.push_back(first + c);
+        nextMin.push_back(levelMin[i] + vec3(cx, cy, cz) * half);
+      }
+    }
+
+    level.swap(nextLevel);
+    levelMin.swap(nextMin);
+    cellSize = half;
+  } // end iterate levels
+}
+
+// Compute the signed distance of all cells, exactly only near the surface
+// 1. exact distance at every factor-th cell along each axis (coarse grid)
+// 2. a coarse cell is refined if a corner is closer to the surface than
+//    the diagonal of the cell, otherwise the surface cannot pass through
+//    it by the 1-Lipschitz property of the distance
+// 3. cells of refined coarse cells get the exact distance,
+//    other cells the trilinear interpolation of their coarse cell
+// Only the cells around the surface are computed exactly, so the cost
+// follows the area of the surface instead of the volume of the grid.
+// A wrong sign on a coarse node would spread over its cells, so coarse
+// nodes and exact cells take the sign of the winding number if wn is
+// given, and the winding number is never evaluated on the other cells.
+void generateSdfCoarseToFine(Grid &grid, Bvh &bvh, WindingNumber *wn,
+                             ThreadPool &pool, int factor) {
+  ivec3 n = grid.nOfCells;
+  int k = glm::max(factor, 1);
+
+  // coarse cells cover all cells, coarse node I is at cell k * I
+  ivec3 nc = (n - 1 + k - 1) / k;
+  nc = glm::max(nc, ivec3(1));
+  ivec3 nn = nc + 1;
+
+  /* 1. coarse nodes */
+  vector<float> coarse(size_t(nn.x) * nn.y * nn.z);
+
+  pool.parallelFor(0, nn.y * nn.z, 1, [&](int rowBegin, int rowEnd) {
+    for (int row = rowBegin; row < rowEnd; row++) {
+      int J = row % nn.y;
+      int K = row / nn.y;
+
+      for (int I = 0; I < nn.x; I++) {
+        vec3 P = vec3(I, J, K) * (float(k) * grid.cellSize) + grid.origin;
+        float dist = bvh.getDistance(P);
+
+        if (wn) {
+          dist = isInside(bvh, wn, P) ? -abs(dist) : abs(dist);
+        }
+        coarse[I + size_t(row) * nn.x] = dist;
+      }
+    }
+  });
+
+  auto coarseAt = [&](int I, int J, int K) {
+    return coarse[I + (J + size_t(K) * nn.y) * nn.x];
+  };
+
+  /* 2. coarse cells the surface may pass through */
+  float diagonal = k * grid.cellSize * sqrt(3.f);
+  vector<char> refined(size_t(nc.x) * nc.y * nc.z);
+
+  for (int K = 0; K < nc.z; K++) {
+    for (int J = 0; J < nc.y; J++) {
+      for (int I = 0; I < nc.x; I++) {
+        float nearest = 9999.f;
+
+        for (int c = 0; c < 8; c++) {
+          float d = coarseAt(I + (c & 1), J + ((c >> 1) & 1), K + (c >> 2));
+          nearest = glm::min(nearest, abs(d));
+        }
+
+        refined[I + (J + size_t(K) * nc.y) * nc.x] = (nearest <= diagonal);
+      }
+    }
+  }
+
+  // a cell on the face of a coarse cell belongs to both sides,
+  // so it is exact if any coarse cell around it is refined
+  auto isRefined = [&](ivec3 idx) {
+    ivec3 lo, hi;
+
+    for (int a = 0; a < 3; a++) {
+      hi[a] = glm::min(idx[a] / k, nc[a] - 1);
+      lo[a] = (idx[a] % k == 0) ? glm::max(idx[a] / k - 1, 0) : hi[a];
+    }
+
+    for (int K = lo.z; K <= hi.z; K++) {
+      for (int J = lo.y; J <= hi.y; J++) {
+        for (int I = lo.x; I <= hi.x; I++) {
+          if (refined[I + (J + size_t(K) * nc.y) * nc.x]) {
+            return true;
+          }
+        }
+      }
+    }
+
+    return false;
+  };
+
+  /* 3. fine cells */
+  int nOfRows = n.y * n.z;
+  int grain = glm::max(1, nOfRows / (pool.size() * 8));
+
+  pool.parallelFor(0, nOfRows, grain, [&](int rowBegin, int rowEnd) {
+    for (int row = rowBegin; row < rowEnd; row++) {
+      int iy = row % n.y;
+      int iz = row / n.y;
+
+      for (int ix = 0; ix < n.x; ix++) {
+        ivec3 idx(ix, iy, iz);
+        float dist;
+
+        if (isRefined(idx)) {
+          // same as the cell position in initGrid()
+          vec3 P = vec3(idx) * grid.cellSize + grid.origin;
+          dist = bvh.getDistance(P);
+
+          if (wn) {
+            dist = isInside(bvh, wn, P) ? -abs(dist) : abs(dist);
+          }
+        } else {
+          ivec3 I = glm::min(idx / k, nc - 1);
+          vec3 t = vec3(idx - I * k) / float(k);
+
+          float d[8];
+          for (int c = 0; c < 8; c++) {
+            d[c] = coarseAt(I.x + (c & 1), I.y + ((c >> 1) & 1),
+                            I.z + (c >> 2));
+          }
+          dist = trilinear(d, t);
+        }
+
+        grid.sd[grid.getHash(idx)] = dist;
+      } // end x direction
+    }   // end rows
+  });
+}
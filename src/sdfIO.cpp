@@ -0,0 +1,611 @@
+#include "sdfIO.h"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+
+// format: x, y, z, i, j, k, dist
+void writeSdf(Grid &gd, const string fileName) {
+  ofstream output(fileName);
+
+  for (size_t i = 0; i < gd.size(); i++) {
+    ivec3 idx = gd.getIdx(int(i));
+    vec3 pos = gd.getPos(idx);
+
+    output << pos.x;
+    output << " ";
+    output << pos.y;
+    output << " ";
+    output << pos.z;
+    output << " ";
+    output << idx.x;
+    output << " ";
+    output << idx.y;
+    output << " ";
+    output << idx.z;
+    output << " ";
+    output << gd.getDistance(int(i));
+    output << '\n';
+  }
+
+  output.close();
+}
+
+// format: x, y, z, i, j, k, dist
+// Grid parameters are recovered from the cells,
+// i.e. the first cell is at the origin
+void readSdf(Grid &gd, const string fileName) {
+  ifstream fin;
+  fin.open(fileName.c_str());
+
+  if (!(fin.good())) {
+    cout << "failed to open file : " << fileName << std::endl;
+  }
+
+  vector<ivec3> idxs;
+  vector<float> sds;
+  vec3 firstPos(0), lastPos(0);
+
+  // read file
+  vec3 pos;
+  ivec3 idx;
+  float sd;
+  while (fin >> pos.x >> pos.y >> pos.z >> idx.x >> idx.y >> idx.z >> sd) {
+    if (idxs.empty()) {
+      firstPos = pos;
+    }
+    lastPos = pos;
+
+    idxs.push_back(idx);
+    sds.push_back(sd);
+  } // end read file
+
+  fin.close();
+
+  if (idxs.empty()) {
+    return;
+  }
+
+  // the last cell has the largest index
+  ivec3 lastIdx = idxs.back();
+  float cellSize = gd.cellSize;
+  for (int a = 0; a < 3; a++) {
+    if (lastIdx[a] > 0) {
+      cellSize = (lastPos[a] - firstPos[a]) / lastIdx[a];
+      break;
+    }
+  }
+
+  gd.init(firstPos, cellSize, lastIdx + 1, 9999.f);
+
+  for (size_t i = 0; i < idxs.size(); i++) {
+    gd.sd[gd.getHash(idxs[i])] = sds[i];
+  }
+}
+
+// Whitespace of the text formats
+static inline bool isSpace(char c) {
+  return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+// # of whitespace separated tokens in [p, end)
+static size_t countTokens(const char *p, const char *end) {
+  size_t n = 0;
+  bool inToken = false;
+
+  for (; p < end; p++) {
+    bool space = isSpace(*p);
+    n += (!space && !inToken);
+    inToken = !space;
+  }
+
+  return n;
+}
+
+// Parse the next token of [p, end) into value
+// Return false if there is no token or it is not a number
+template <typename T> static bool parseToken(const char *&p, const char *end,
+                                             T &value) {
+  while (p < end && isSpace(*p)) {
+    p++;
+  }
+
+  from_chars_result r = from_chars(p, end, value);
+
+  if (r.ec != errc() || r.ptr == p) {
+    // skip the bad token
+    while (p < end && !isSpace(*p)) {
+      p++;
+    }
+    return false;
+  }
+
+  p = r.ptr;
+
+  return true;
+}
+
+// SDF generated by SDFGen
+// from https://github.com/christopherbatty
+// note that the <padding> parameter translates the mesh
+// with (dx * padding)
+void readSdfBatty(Grid &gd, const string fileName) {
+  ThreadPool pool;
+
+  readSdfBatty(gd, fileName, pool);
+}
+
+// format: nx ny nz, origin, dx, then one value per line (x first)
+// The file is mapped and cut into chunks at line boundaries.
+// Tokens of each chunk are counted in parallel, a prefix sum gives
+// the first sample of each chunk, then chunks are parsed in parallel
+// into the preallocated samples.
+void readSdfBatty(Grid &gd, const string fileName, ThreadPool &pool) {
+  MappedFile file;
+
+  if (!file.open(fileName)) {
+    return;
+  }
+
+  const char *p = file.data;
+  const char *end = file.data + file.size;
+
+  /* header */
+  ivec3 n;
+  vec3 origin;
+  float dx;
+  bool ok = true;
+
+  for (int a = 0; a < 3; a++) {
+    ok = ok && parseToken(p, end, n[a]);
+  }
+  for (int a = 0; a < 3; a++) {
+    ok = ok && parseToken(p, end, origin[a]);
+  }
+  ok = ok && parseToken(p, end, dx);
+
+  if (!ok || n.x < 0 || n.y < 0 || n.z < 0) {
+    cout << "bad sdf header : " << fileName << std::endl;
+    return;
+  }
+
+  gd.init(origin, dx, n, 9999.f);
+
+  /* split the samples into chunks at line boundaries */
+  size_t length = end - p;
+  int nOfChunks = (int)glm::min<size_t>(pool.size() * 8, length / 4096 + 1);
+
+  vector<const char *> bounds;
+  splitLines(p, end, nOfChunks, bounds);
+
+  // first sample of each chunk
+  vector<size_t> first(nOfChunks + 1, 0);
+
+  pool.parallelFor(0, nOfChunks, 1, [&](int begin, int stop) {
+    for (int c = begin; c < stop; c++) {
+      first[c + 1] = countTokens(bounds[c], bounds[c + 1]);
+    }
+  });
+
+  for (int c = 0; c < nOfChunks; c++) {
+    first[c + 1] += first[c];
+  }
+
+  if (first[nOfChunks] != gd.sd.size()) {
+    cout << "expected " << gd.sd.size() << " samples but found "
+         << first[nOfChunks] << " : " << fileName << std::endl;
+  }
+
+  /* parse */
+  atomic<size_t> nOfErrors(0);
+
+  pool.parallelFor(0, nOfChunks, 1, [&](int begin, int stop) {
+    for (int c = begin; c < stop; c++) {
+      const char *q = bounds[c];
+      size_t i = first[c];
+      size_t errors = 0;
+
+      for (; i < first[c + 1] && i < gd.sd.size(); i++) {
+        errors += !parseToken(q, bounds[c + 1], gd.sd[i]);
+      }
+
+      nOfErrors += errors;
+    }
+  });
+
+  if (nOfErrors > 0) {
+    cout << nOfErrors << " bad values : " << fileName << std::endl;
+  }
+}
+
+// Write the grid in the binary format (see SdfHeader)
+void writeSdfBinary(Grid &gd, const string fileName) {
+  SdfHeader header;
+  memset(&header, 0, sizeof(header));
+
+  memcpy(header.magic, SDF_MAGIC, 4);
+  header.version = SDF_VERSION;
+  for (int a = 0; a < 3; a++) {
+    header.nOfCells[a] = gd.nOfCells[a];
+    header.origin[a] = gd.origin[a];
+  }
+  header.cellSize = gd.cellSize;
+  header.valueType = SDF_FLOAT32;
+  header.layout = gd.layout;
+  header.dataOffset = sizeof(SdfHeader);
+
+  ofstream output(fileName, ios::binary);
+
+  if (!(output.good())) {
+    cout << "failed to open file : " << fileName << std::endl;
+    return;
+  }
+
+  output.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  output.write(reinterpret_cast<const char *>(gd.samples),
+               gd.getStorageSize() * sizeof(float));
+
+  output.close();
+}
+
+// Map a binary sdf file and let the grid read its samples in place
+// The file must stay mapped while the grid is used.
+// Return false if the file is not a valid binary sdf.
+bool mapSdf(Grid &gd, MappedFile &file, const string fileName) {
+  if (!file.open(fileName)) {
+    return false;
+  }
+
+  if (file.size < sizeof(SdfHeader)) {
+    cout << "not a binary sdf : " << fileName << std::endl;
+    file.close();
+    return false;
+  }
+
+  SdfHeader header;
+  memcpy(&header, file.data, sizeof(header));
+
+  if (memcmp(header.magic, SDF_MAGIC, 4) != 0) {
+    cout << "not a binary sdf : " << fileName << std::endl;
+    file.close();
+    return false;
+  }
+
+  if (header.version != SDF_VERSION || header.valueType != SDF_FLOAT32 ||
+      (header.layout != SDF_LAYOUT_LINEAR &&
+       header.layout != SDF_LAYOUT_BRICKED)) {
+    cout << "unsupported sdf version " << header.version << ", value type "
+         << header.valueType << ", layout " << header.layout << " : "
+         << fileName << std::endl;
+    file.close();
+    return false;
+  }
+
+  // NaN fails the test too, queries divide by the cell size
+  if (!(header.cellSize > 0.f)) {
+    cout << "invalid cell size " << header.cellSize << " : " << fileName
+         << std::endl;
+    file.close();
+    return false;
+  }
+
+  ivec3 n(header.nOfCells[0], header.nOfCells[1], header.nOfCells[2]);
+  size_t nOfSamples = size_t(n.x) * n.y * n.z;
+
+  // bricks on the border are padded
+  if (header.layout == SDF_LAYOUT_BRICKED) {
+    ivec3 nb = (n + BRICK_SIZE - 1) / BRICK_SIZE;
+    nOfSamples = size_t(nb.x) * nb.y * nb.z * BRICK_CELLS;
+  }
+
+  if (n.x < 0 || n.y < 0 || n.z < 0 || header.dataOffset % sizeof(float) ||
+      header.dataOffset + nOfSamples * sizeof(float) > file.size) {
+    cout << "truncated sdf : " << fileName << std::endl;
+    file.close();
+    return false;
+  }
+
+  gd.sd.clear();
+  gd.sd.shrink_to_fit();
+  gd.origin = vec3(header.origin[0], header.origin[1], header.origin[2]);
+  gd.cellSize = header.cellSize;
+  gd.nOfCells = n;
+  gd.initLayout(header.layout);
+
+  gd.samples = reinterpret_cast<const float *>(file.data + header.dataOffset);
+
+  return true;
+}
+
+// Binary sdf files are recognized by SDF_EXTENSION
+bool isBinarySdf(const string fileName) {
+  string ext = SDF_EXTENSION;
+
+  return fileName.size() >= ext.size() &&
+         fileName.compare(fileName.size() - ext.size(), ext.size(), ext) == 0;
+}
+
+// File of level l of a pyramid, e.g. bunny.sdf -> bunny.2.sdf
+string sdfLevelName(const string fileName, int level) {
+  size_t dot = fileName.find_last_of('.');
+  size_t slash = fileName.find_last_of('/');
+
+  // no extension
+  if (dot == string::npos || (slash != string::npos && dot < slash)) {
+    return fileName + "." + to_string(level);
+  }
+
+  return fileName.substr(0, dot) + "." + to_string(level) +
+         fileName.substr(dot);
+}
+
+// Map the coarse levels written next to a binary sdf by createSdf -levels
+// on top of grid, files[l] keeps level l mapped.
+// Return the # of levels, 1 if there is no coarse level.
+int mapSdfPyramid(SdfPyramid &pyramid, Grid &grid, MappedFile *files,
+                  const string fileName) {
+  pyramid.fine = &grid;
+  pyramid.coarse.clear();
+
+  for (int l = 1; l < PYRAMID_MAX_LEVELS; l++) {
+    string levelName = sdfLevelName(fileName, l);
+
+    // quietly stop at the first missing level
+    if (!ifstream(levelName).good()) {
+      break;
+    }
+
+    Grid level;
+    if (!mapSdf(level, files[l], levelName)) {
+      break;
+    }
+    pyramid.coarse.push_back(level);
+  }
+
+  return pyramid.getNumLevels();
+}
+
+// Write the sparse grid in the binary format (see SparseSdfHeader)
+void writeSparseSdf(SparseGrid &gd, const string fileName) {
+  vector<pair<uint64_t, SparseRootRecord>> entries;
+
+  for (auto it = gd.root.begin(); it != gd.root.end(); it++) {
+    SparseRootRecord record;
+    record.node = it->second.node;
+    record.tile = it->second.tile;
+
+    // the key packs the node index, see sparseKey()
+    for (int a = 0; a < 3; a++) {
+      record.idx[a] = int32_t((it->first >> (21 * a)) & 0x1fffff) - (1 << 20);
+    }
+    entries.push_back(make_pair(it->first, record));
+  }
+  sort(entries.begin(), entries.end(),
+       [](const pair<uint64_t, SparseRootRecord> &a,
+          const pair<uint64_t, SparseRootRecord> &b) {
+         return a.first < b.first;
+       });
+
+  SparseSdfHeader header;
+  memset(&header, 0, sizeof(header));
+
+  memcpy(header.magic, SPARSE_SDF_MAGIC, 4);
+  header.version = SPARSE_SDF_VERSION;
+  for (int a = 0; a < 3; a++) {
+    header.nOfCells[a] = gd.nOfCells[a];
+    header.origin[a] = gd.origin[a];
+  }
+  header.cellSize = gd.cellSize;
+  header.background = gd.background;
+  header.nOfRootEntries = entries.size();
+  header.nOfNodes = gd.nodeIdxs.size();
+  header.nOfLeaves = gd.leafIdxs.size();
+
+  ofstream output(fileName, ios::binary);
+
+  if (!(output.good())) {
+    cout << "failed to open file : " << fileName << std::endl;
+    return;
+  }
+
+  output.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  for (size_t i = 0; i < entries.size(); i++) {
+    output.write(reinterpret_cast<const char *>(&entries[i].second),
+                 sizeof(SparseRootRecord));
+  }
+  output.write(reinterpret_cast<const char *>(gd.nodeChildren.data()),
+               gd.nodeChildren.size() * sizeof(int));
+  output.write(reinterpret_cast<const char *>(gd.nodeTiles.data()),
+               gd.nodeTiles.size() * sizeof(float));
+  output.write(reinterpret_cast<const char *>(gd.leafIdxs.data()),
+               gd.leafIdxs.size() * sizeof(ivec3));
+  output.write(reinterpret_cast<const char *>(gd.leafSamples.data()),
+               gd.leafSamples.size() * sizeof(float));
+
+  output.close();
+}
+
+// Read a sparse sdf written by writeSparseSdf()
+// Return false if the file is not a valid sparse sdf.
+bool readSparseSdf(SparseGrid &gd, const string fileName) {
+  MappedFile file;
+
+  if (!file.open(fileName)) {
+    return false;
+  }
+
+  SparseSdfHeader header;
+
+  if (file.size < sizeof(header)) {
+    cout << "not a sparse sdf : " << fileName << std::endl;
+    return false;
+  }
+  memcpy(&header, file.data, sizeof(header));
+
+  if (memcmp(header.magic, SPARSE_SDF_MAGIC, 4) != 0 ||
+      header.version != SPARSE_SDF_VERSION) {
+    cout << "not a sparse sdf : " << fileName << std::endl;
+    return false;
+  }
+
+  size_t nOfNodes = header.nOfNodes;
+  size_t nOfLeaves = header.nOfLeaves;
+  size_t nOfChildren = nOfNodes * SPARSE_NODE_CHILDREN;
+  size_t total = sizeof(header) +
+                 header.nOfRootEntries * sizeof(SparseRootRecord) +
+                 nOfChildren * (sizeof(int) + sizeof(float)) +
+                 nOfLeaves * (sizeof(ivec3) + BRICK_CELLS * sizeof(float));
+
+  if (file.size < total) {
+    cout << "truncated sdf : " << fileName << std::endl;
+    return false;
+  }
+
+  ivec3 n(header.nOfCells[0], header.nOfCells[1], header.nOfCells[2]);
+  vec3 origin(header.origin[0], header.origin[1], header.origin[2]);
+  gd.init(origin, header.cellSize, n, header.background);
+
+  const char *p = file.data + sizeof(header);
+
+  gd.nodeIdxs.resize(nOfNodes);
+  for (uint32_t i = 0; i < header.nOfRootEntries; i++) {
+    SparseRootRecord record;
+    memcpy(&record, p, sizeof(record));
+    p += sizeof(record);
+
+    ivec3 idx(record.idx[0], record.idx[1], record.idx[2]);
+
+    if (record.node != SPARSE_TILE) {
+      if (record.node < 0 || size_t(record.node) >= nOfNodes) {
+        cout << "bad sparse sdf node : " << fileName << std::endl;
+        gd.init(origin, header.cellSize, n, header.background);
+        return false;
+      }
+      gd.nodeIdxs[record.node] = idx;
+    }
+
+    SparseGrid::RootEntry entry;
+    entry.node = record.node;
+    entry.tile = record.tile;
+    gd.root[sparseKey(idx)] = entry;
+  }
+
+  gd.nodeChildren.resize(nOfChildren);
+  memcpy(gd.nodeChildren.data(), p, nOfChildren * sizeof(int));
+  p += nOfChildren * sizeof(int);
+
+  for (size_t i = 0; i < nOfChildren; i++) {
+    if (gd.nodeChildren[i] >= int64_t(nOfLeaves)) {
+      cout << "bad sparse sdf leaf : " << fileName << std::endl;
+      gd.init(origin, header.cellSize, n, header.background);
+      return false;
+    }
+  }
+
+  gd.nodeTiles.resize(nOfChildren);
+  memcpy(gd.nodeTiles.data(), p, nOfChildren * sizeof(float));
+  p += nOfChildren * sizeof(float);
+
+  gd.leafIdxs.resize(nOfLeaves);
+  memcpy(gd.leafIdxs.data(), p, nOfLeaves * sizeof(ivec3));
+  p += nOfLeaves * sizeof(ivec3);
+
+  gd.leafSamples.resize(nOfLeaves * BRICK_CELLS);
+  memcpy(gd.leafSamples.data(), p, nOfLeaves * BRICK_CELLS * sizeof(float));
+
+  return true;
+}
+
+// Sparse sdf files share SDF_EXTENSION, they are told apart by the magic
+bool isSparseSdf(const string fileName) {
+  char magic[4] = {0};
+
+  ifstream ifs(fileName, ios::binary);
+  ifs.read(magic, 4);
+
+  return ifs && memcmp(magic, SPARSE_SDF_MAGIC, 4) == 0;
+}
+
+// Write the adaptive distance field in the binary format (see AdfHeader)
+void writeAdf(Adf &adf, const string fileName) {
+  AdfHeader header;
+  memset(&header, 0, sizeof(header));
+
+  memcpy(header.magic, ADF_MAGIC, 4);
+  header.version = ADF_VERSION;
+  for (int a = 0; a < 3; a++) {
+    header.origin[a] = adf.origin[a];
+  }
+  header.size = adf.size;
+  header.maxDepth = adf.maxDepth;
+  header.tolerance = adf.tolerance;
+  header.maxDistance = adf.maxDistance;
+  header.nOfNodes = adf.nodes.size();
+
+  ofstream output(fileName, ios::binary);
+
+  if (!(output.good())) {
+    cout << "failed to open file : " << fileName << std::endl;
+    return;
+  }
+
+  output.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  output.write(reinterpret_cast<const char *>(adf.nodes.data()),
+               adf.nodes.size() * sizeof(AdfNode));
+
+  output.close();
+}
+
+// Read an adaptive distance field written by writeAdf()
+// Return false if the file is not a valid adf.
+bool readAdf(Adf &adf, const string fileName) {
+  MappedFile file;
+
+  if (!file.open(fileName)) {
+    return false;
+  }
+
+  AdfHeader header;
+
+  if (file.size < sizeof(header)) {
+    cout << "not an adf : " << fileName << std::endl;
+    return false;
+  }
+  memcpy(&header, file.data, sizeof(header));
+
+  if (memcmp(header.magic, ADF_MAGIC, 4) != 0 ||
+      header.version != ADF_VERSION) {
+    cout << "not an adf : " << fileName << std::endl;
+    return false;
+  }
+
+  size_t nOfNodes = header.nOfNodes;
+
+  if (file.size < sizeof(header) + nOfNodes * sizeof(AdfNode)) {
+    cout << "truncated adf : " << fileName << std::endl;
+    return false;
+  }
+
+  adf.nodes.resize(nOfNodes);
+  memcpy(adf.nodes.data(), file.data + sizeof(header),
+         nOfNodes * sizeof(AdfNode));
+
+  // children must be after their parent, so a query always ends
+  for (size_t i = 0; i < nOfNodes; i++) {
+    int c = adf.nodes[i].children;
+
+    if (c >= 0 && (size_t(c) <= i || size_t(c) + 8 > nOfNodes)) {
+      cout << "bad adf node : " << fileName << std::endl;
+      adf.nodes.clear();
+      return false;
+    }
+  }
+
+  adf.origin = vec3(header.origin[0], header.origin[1], header.origin[2]);
+  adf.size = header.size;
+  adf.maxDepth = header.maxDepth;
+  adf.tolerance = header.tolerance;
+  adf.maxDistance = header.maxDistance;
+
+  return true;
+}
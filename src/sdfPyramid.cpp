@@ -0,0 +1,138 @@
+#include "sdfPyramid.h"
+
+// Next level of the pyramid
+// Coarse sample I is at fine sample 2I, and takes the min of the fine
+// samples in [2I - 2, 2I + 2]^3, i.e. of all the coarse cells around it.
+// The min is separable, so it is taken along x, then y, then z.
+Grid downsampleMin(Grid &src, ThreadPool &pool) {
+  ivec3 n = src.nOfCells;
+
+  // enough samples to cover the last fine sample
+  ivec3 nc = n / 2 + 1;
+
+  Grid dst;
+  dst.init(src.origin, src.cellSize * 2.f, nc, 9999.f);
+
+  // tmpX: nc.x * n.y * n.z, tmpY: nc.x * nc.y * n.z
+  vector<float> tmpX(size_t(nc.x) * n.y * n.z);
+  vector<float> tmpY(size_t(nc.x) * nc.y * n.z);
+
+  /* along x */
+  pool.parallelFor(0, n.y * n.z, 64, [&](int rowBegin, int rowEnd) {
+    for (int row = rowBegin; row < rowEnd; row++) {
+      int j = row % n.y;
+      int k = row / n.y;
+
+      for (int i = 0; i < nc.x; i++) {
+        int lo = glm::max(2 * i - 2, 0);
+        int hi = glm::min(2 * i + 2, n.x - 1);
+
+        float m = 9999.f;
+        for (int x = lo; x <= hi; x++) {
+          m = glm::min(m, src.samples[src.getOffset(ivec3(x, j, k))]);
+        }
+        tmpX[i + size_t(row) * nc.x] = m;
+      }
+    }
+  });
+
+  /* along y */
+  pool.parallelFor(0, n.z, 1, [&](int kBegin, int kEnd) {
+    for (int k = kBegin; k < kEnd; k++) {
+      for (int j = 0; j < nc.y; j++) {
+        int lo = glm::max(2 * j - 2, 0);
+        int hi = glm::min(2 * j + 2, n.y - 1);
+
+        for (int i = 0; i < nc.x; i++) {
+          float m = 9999.f;
+          for (int y = lo; y <= hi; y++) {
+            m = glm::min(m, tmpX[i + (y + size_t(k) * n.y) * nc.x]);
+          }
+          tmpY[i + (j + size_t(k) * nc.y) * nc.x] = m;
+        }
+      }
+    }
+  });
+
+  /* along z */
+  pool.parallelFor(0, nc.z, 1, [&](int kBegin, int kEnd) {
+    for (int k = kBegin; k < kEnd; k++) {
+      int lo = glm::max(2 * k - 2, 0);
+      int hi = glm::min(2 * k + 2, n.z - 1);
+
+      for (int j = 0; j < nc.y; j++) {
+        for (int i = 0; i < nc.x; i++) {
+          float m = 9999.f;
+          for (int z = lo; z <= hi; z++) {
+            m = glm::min(m, tmpY[i + (j + size_t(z) * nc.y) * nc.x]);
+          }
+          dst.sd[dst.getHash(ivec3(i, j, k))] = m;
+        }
+      }
+    }
+  });
+
+  return dst;
+}
+
+/* Member functions of SdfPyramid */
+// Build nOfLevels levels on top of the grid, including the grid
+// The grid must outlive the pyramid.
+void SdfPyramid::build(Grid &grid, int nOfLevels, ThreadPool &pool) {
+  fine = &grid;
+  coarse.clear();
+
+  nOfLevels = glm::clamp(nOfLevels, 1, PYRAMID_MAX_LEVELS);
+
+  for (int l = 1; l < nOfLevels; l++) {
+    Grid &src = (l == 1) ? grid : coarse.back();
+
+    // nothing left to downsample
+    if (glm::min(glm::min(src.nOfCells.x, src.nOfCells.y), src.nOfCells.z) <
+        2) {
+      break;
+    }
+
+    coarse.push_back(downsampleMin(src, pool));
+  }
+}
+
+Grid &SdfPyramid::getGrid(int level) {
+  return (level == 0) ? *fine : coarse[level - 1];
+}
+
+// How far below level 0 the distance of a level can be
+// A sample of level l is the min over a box of half side
+// H + H / 2 + ... < 2H around it, H = cellSize of level l,
+// so it is below the distance at the sample by < 2 * sqrt(3) * H,
+// and a point is at most sqrt(3) * H away from the samples of its cell.
+float SdfPyramid::getErrorBound(int level) {
+  if (level == 0) {
+    return 0.f;
+  }
+
+  return 3.f * sqrt(3.f) * getGrid(level).cellSize;
+}
+
+// The coarsest level whose error bound is within tolerance
+int SdfPyramid::getLevel(float tolerance) {
+  int level = 0;
+
+  while (level + 1 < getNumLevels() &&
+         getErrorBound(level + 1) <= tolerance) {
+    level++;
+  }
+
+  return level;
+}
+
+float SdfPyramid::getDistance(vec3 p, float tolerance) {
+  vec3 grad;
+
+  return getDistanceGradient(p, grad, tolerance);
+}
+
+// Trilinear distance and gradient at p from the level of tolerance
+float SdfPyramid::getDistanceGradient(vec3 p, vec3 &grad, float tolerance) {
+  return getGrid(getLevel(tolerance)).getDistanceGradient(p, grad);
+}
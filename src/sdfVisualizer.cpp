@@ -1,5 +1,6 @@
 #include "common.h"
 #include "sdf.h"
+#include "sdfIO.h"
 
 GLFWwindow *window;
 
@@ -24,9 +25,11 @@ vec3 up = vec3(0.f, 1.f, 0.f);
 /* for sdf */
 ivec3 nOfCells;
 float cellSize = 0.1f;
-vec3 gridOrigin(0, 0, 0);
-vec3 rangeOffset(0.2f, 0.2f, 0.2f);
 Grid grid;
+string sdfFile = "sdfBunnyBatty.txt"; // SDFGen text, or binary *.sdf
+MappedFile sdfMap;
+SparseGrid sparse; // used instead of grid for a sparse sdf file
+bool isSparse = false;
 
 Mesh mesh;
 
@@ -51,19 +54,26 @@ void initGrid();
 void initMesh();
 void releaseResource();
 
-void readSdf(Grid &, const string);
-void readSdfBatty(Grid &, const string);
 vec3 calCellPos(vec3);
 float randf();
 
 int main(int argc, char const *argv[]) {
+  // sdfVisualizer [sdf file]
+  if (argc > 1) {
+    sdfFile = argv[1];
+  }
+
   initGL();
   initOther();
   initShader();
+
+  // the mesh and the view are placed relative to the grid
+  initGrid();
+  eyePoint += isSparse ? sparse.origin : grid.origin;
+
   initMatrix();
   initLight();
 
-  initGrid();
   initMesh();
 
   // test points
@@ -74,16 +84,35 @@ int main(int argc, char const *argv[]) {
   //   p.color = vec3(0.5, 0.5, 0.5);
   //   pts.push_back(p);
   // }
-  for (size_t i = 0; i < grid.cells.size(); i++) {
-    Cell &cell = grid.cells[i];
-    if (cell.sd < 0) {
+  for (size_t i = 0; i < grid.size(); i++) {
+    if (grid.getDistance(int(i)) < 0) {
       Point p;
-      p.pos = cell.pos;
+      p.pos = grid.getPos(int(i));
       p.color = vec3(0.5, 0.5, 0.5);
       pts.push_back(p);
     }
   }
 
+  // cells of a sparse grid, inside ones are in leaves or inside tiles
+  if (isSparse) {
+    ivec3 n = sparse.nOfCells;
+
+    for (int k = 0; k < n.z; k++) {
+      for (int j = 0; j < n.y; j++) {
+        for (int i = 0; i < n.x; i++) {
+          vec3 pos = sparse.getPos(ivec3(i, j, k));
+
+          if (sparse.getDistance(pos) < 0) {
+            Point p;
+            p.pos = pos;
+            p.color = vec3(0.5, 0.5, 0.5);
+            pts.push_back(p);
+          }
+        }
+      }
+    }
+  }
+
   /* glfw loop */
   // a rough way to solve cursor position initialization problem
   // must call glfwPollEvents once to activate glfwSetCursorPos
@@ -265,6 +294,7 @@ void initShader() {
 }
 
 void releaseResource() {
+  releaseMesh(mesh);
   glfwTerminate();
   FreeImage_DeInitialise();
 }
@@ -332,7 +362,7 @@ void computeMatricesFromInputs(mat4 &newProject, mat4 &newView) {
 // calculate the position of the cell which covers the specified point
 vec3 calCellPos(vec3 pt) {
   // change reference frame
-  vec3 ptRef = pt - gridOrigin;
+  vec3 ptRef = pt - grid.origin;
 
   // grid index along each axis of this cell
   int ix = int(floor(ptRef.x / cellSize));
@@ -343,7 +373,7 @@ vec3 calCellPos(vec3 pt) {
   vec3 posRef = vec3(ix * cellSize, iy * cellSize, iz * cellSize);
 
   // change reference frame
-  vec3 pos = posRef + gridOrigin;
+  vec3 pos = posRef + grid.origin;
 
   return pos;
 }
@@ -362,87 +392,15 @@ void initGrid() {
   //
   // readSdf(grid, "sdfBunnyMine.txt");
 
-  readSdfBatty(grid, "sdfBunnyBatty.txt");
-}
-
-// format: x, y, z, i, j, k, dist
-void readSdf(Grid &gd, const string fileName) {
-  ifstream fin;
-  fin.open(fileName.c_str());
-
-  if (!(fin.good())) {
-    cout << "failed to open file : " << fileName << std::endl;
-  }
-
-  // read file
-  while (fin.peek() != EOF) {
-    Cell cell;
-
-    fin >> cell.pos.x;
-    fin >> cell.pos.y;
-    fin >> cell.pos.z;
-
-    fin >> cell.idx.x;
-    fin >> cell.idx.y;
-    fin >> cell.idx.z;
-
-    fin >> cell.sd;
-
-    gd.cells.push_back(cell);
-  } // end read file
-
-  fin.close();
-}
-
-// SDF generated by SDFGen
-// from https://github.com/christopherbatty
-// note that the <padding> parameter translates the mesh
-// with (dx * padding)
-void readSdfBatty(Grid &gd, const string fileName) {
-  ifstream fin;
-  fin.open(fileName.c_str());
-
-  if (!(fin.good())) {
-    cout << "failed to open file : " << fileName << std::endl;
-  }
-
-  // # of cells
-  fin >> gd.nOfCells.x;
-  fin >> gd.nOfCells.y;
-  fin >> gd.nOfCells.z;
-
-  // origin
-  fin >> gd.origin.x;
-  fin >> gd.origin.y;
-  fin >> gd.origin.z;
-  // assume the origin is always (0, 0, 0)
-  gd.origin = vec3(0);
-
-  // cell size
-  fin >> gd.cellSize;
-
-  // read sdf
-  for (size_t k = 0; k < gd.nOfCells.z; k++) {
-    for (size_t j = 0; j < gd.nOfCells.y; j++) {
-      for (size_t i = 0; i < gd.nOfCells.x; i++) {
-        Cell cell;
-
-        cell.pos = vec3(i * gd.cellSize, j * gd.cellSize, k * gd.cellSize);
-        cell.pos += gd.origin;
-
-        // if padding is 1
-        // cell.pos += vec3(gd.cellSize * 1.f);
-
-        cell.idx = ivec3(i, j, k);
-
-        fin >> cell.sd;
-
-        gd.cells.push_back(cell);
-      }
-    }
+  if (isSparseSdf(sdfFile)) {
+    // written by createSdf -sparse
+    isSparse = readSparseSdf(sparse, sdfFile);
+  } else if (isBinarySdf(sdfFile)) {
+    // zero copy, samples are read from the mapped file
+    mapSdf(grid, sdfMap, sdfFile);
+  } else {
+    readSdfBatty(grid, sdfFile);
   }
-
-  fin.close();
 }
 
 void initOther() {
@@ -463,10 +421,8 @@ void initMesh() {
   createMesh(mesh);
   findAABB(mesh);
 
-  // transform mesh to (origin + offset) position
-  vec3 offset = (gridOrigin - mesh.min) + rangeOffset;
-  mesh.translate(offset + vec3(-grid.cellSize * 1.f));
-  updateMesh(mesh);
+  // the sdf is in the frame of the obj file,
+  // so the mesh is already at its place in the grid
 }
 
 void keyCallback(GLFWwindow *keyWnd, int key, int scancode, int action,
@@ -1,5 +1,6 @@
 #include "common.h"
 #include "sdf.h"
+#include "sdfIO.h"
 
 GLint uniParM, uniParV, uniParP;
 GLint uniMeshM, uniMeshV, uniMeshP;
@@ -7,7 +8,10 @@ GLint uniMeshLightPos, uniMeshLightColor, uniMeshLightPower;
 GLint uniEyePoint;
 GLFWwindow *window;
 GLuint shaderPar, shaderSphere;
-Particles particles;
+Particles particles;           // buffers for drawing
+ParticleSystem particleSystem; // positions, velocities and masses
+ThreadPool pool;
+
 Mesh mesh;
 
 void initGL();
@@ -20,16 +24,11 @@ void initUniform();
 void initGrid();
 void releaseResource();
 void step();
-void loadPoints(Particles &, const string);
+void loadPoints(ParticleSystem &, const string);
 void computeMatricesFromInputs();
 void keyCallback(GLFWwindow *, int, int, int, int);
-void readSdf(Grid &, const string);
-void readSdfBatty(Grid &, const string);
 float randf();
 
-float dt = 0.01;
-vec3 g(0, -9.8, 0);
-
 // for view control
 float verticalAngle = -1.88085;
 float horizontalAngle = 1.52901;
@@ -51,24 +50,37 @@ vec3 up = vec3(0.f, 1.f, 0.f);
 /* for sdf */
 ivec3 nOfCells;
 float cellSize = 0.1f;
-vec3 gridOrigin(0, 0, 0);
-vec3 rangeOffset(0.2f, 0.2f, 0.2f);
 Grid grid;
+string sdfFile = "sdfBunnyBatty.txt"; // SDFGen text, or binary *.sdf
+MappedFile sdfMap;
+
+// coarse levels for the broad phase
+SdfPyramid pyramid;
+MappedFile levelMaps[PYRAMID_MAX_LEVELS];
 
 unsigned int frameNumber = 0;
 bool saveTrigger = true;
 
 int main(int argc, char **argv) {
+  // simulation [sdf file]
+  if (argc > 1) {
+    sdfFile = argv[1];
+  }
+
   initGL();
   initOther();
   initShader();
+
+  // the mesh, the particles and the view are placed relative to the grid
+  initGrid();
+  eyePoint += grid.origin;
+
   initMatrix();
   initUniform();
 
   initParticles();
 
   initMesh();
-  initGrid();
 
   // a rough way to solve cursor position initialization problem
   // must call glfwPollEvents once to activate glfwSetCursorPos
@@ -94,7 +106,7 @@ int main(int argc, char **argv) {
     glUniformMatrix4fv(uniParV, 1, GL_FALSE, value_ptr(commonV));
     glUniformMatrix4fv(uniParP, 1, GL_FALSE, value_ptr(commonP));
 
-    drawPoints(particles);
+    drawPoints(particles, particleSystem);
 
     // draw mesh
     glUseProgram(shaderSphere);
@@ -207,26 +219,28 @@ void initMatrix() {
 }
 
 void initParticles() {
-  loadPoints(particles, "particles.txt");
+  loadPoints(particleSystem, "particles.txt");
+  particleSystem.contactRadius = 0.05f;
+  particleSystem.sleepSteps = 30;
 
   // create buffer
-  int nOfPs = particles.Ps.size();
+  int nOfPs = particleSystem.size();
   GLfloat *aPos = new GLfloat[nOfPs * 3];
   GLfloat *aColor = new GLfloat[nOfPs * 3];
 
   // implant data
   for (size_t i = 0; i < nOfPs; i++) {
-    Point &p = particles.Ps[i];
+    vec3 pos = particleSystem.getPos(i);
 
     // positions
-    aPos[i * 3 + 0] = p.pos.x;
-    aPos[i * 3 + 1] = p.pos.y;
-    aPos[i * 3 + 2] = p.pos.z;
-
-    // colors
-    aColor[i * 3 + 0] = p.color.r;
-    aColor[i * 3 + 1] = p.color.g;
-    aColor[i * 3 + 2] = p.color.b;
+    aPos[i * 3 + 0] = pos.x;
+    aPos[i * 3 + 1] = pos.y;
+    aPos[i * 3 + 2] = pos.z;
+
+    // colors, the same for all particles
+    aColor[i * 3 + 0] = 0.5f;
+    aColor[i * 3 + 1] = 0.5f;
+    aColor[i * 3 + 2] = 0.5f;
   }
 
   // initialize buffer objects
@@ -258,57 +272,20 @@ void initMesh() {
 
   findAABB(mesh);
 
-  // transform mesh to (origin + offset) position
-  vec3 offset = (gridOrigin - mesh.min) + rangeOffset;
-  mesh.translate(offset + vec3(-grid.cellSize * 1.f));
-  updateMesh(mesh);
+  // the sdf is in the frame of the obj file,
+  // so the mesh is already at its place in the grid
 }
 
-void releaseResource() { glfwTerminate(); }
-
-void step() {
-  int nOfPs = particles.Ps.size();
-
-  for (size_t i = 0; i < nOfPs; i++) {
-    Point &p = particles.Ps[i];
-
-    p.v += dt * g;
-
-    // collision detection
-    float dist = grid.getDistance(p.pos);
-
-    if (dist < 0.1f) {
-      vec3 n = grid.getGradient(p.pos);
-
-      vec3 vVer = -dot(p.v, -n) * (-n);
-      vec3 vHor = p.v - dot(p.v, -n) * (-n);
-
-      // float mu = 0.55f;
-      // if (length(vHor) < -mu * length(vVer)) {
-      //   p.v = vec3(0);
-      // } else {
-      //   p.v = vHor + mu * length(vVer) * normalize(vVer);
-      // }
-      float fric = 0.3f;
-      p.v = (vVer + vHor) * fric;
-    }
-
-    // update position
-    p.pos += dt * p.v;
-
-    // if a particle has moved into an object
-    // push it out
-    float newDist = grid.getDistance(p.pos);
-    if (newDist < 0.f) {
-      newDist *= 2.f; // for visualization convenience
-      vec3 newGrad = grid.getGradient(p.pos);
-      p.pos += newDist * newGrad;
-    }
-
-  } // end iterating particles
+void releaseResource() {
+  releaseMesh(mesh);
+  glfwTerminate();
 }
 
-void loadPoints(Particles &pars, const string fileName) {
+// gravity, collision response and push-out,
+// see ParticleSystem::step()
+void step() { particleSystem.step(pyramid, pool); }
+
+void loadPoints(ParticleSystem &pars, const string fileName) {
   // read point information from file
   ifstream ifs(fileName);
 
@@ -323,16 +300,14 @@ void loadPoints(Particles &pars, const string fileName) {
     // otherwise, the last empty line will be read
     ifs.ignore(1);
 
-    Point p;
-    p.pos = vec3(x, y, z);
-    p.color = vec3(0.5, 0.5, 0.5);
-    p.v = vec3(randf() - 0.5f, randf() - 0.5f, randf() - 0.5f);
-    p.m = randf();
+    vec3 pos(x, y, z);
+    vec3 v(randf() - 0.5f, randf() - 0.5f, randf() - 0.5f);
+    float m = randf();
 
-    // transform
-    p.pos += vec3(0, 4.f, 0);
+    // relative to the grid origin
+    pos += grid.origin + vec3(0, 4.f, 0);
 
-    pars.Ps.push_back(p);
+    pars.add(pos, v, m);
   }
 
   ifs.close();
@@ -466,88 +441,6 @@ void initUniform() {
   glUniform3fv(uniEyePoint, 1, value_ptr(eyePoint));
 }
 
-void readSdf(Grid &gd, const string fileName) {
-  ifstream fin;
-  fin.open(fileName.c_str());
-
-  if (!(fin.good())) {
-    cout << "failed to open file : " << fileName << std::endl;
-  }
-
-  // read file
-  while (fin.peek() != EOF) {
-    Cell cell;
-
-    fin >> cell.pos.x;
-    fin >> cell.pos.y;
-    fin >> cell.pos.z;
-
-    fin >> cell.idx.x;
-    fin >> cell.idx.y;
-    fin >> cell.idx.z;
-
-    fin >> cell.sd;
-
-    gd.cells.push_back(cell);
-  } // end read file
-
-  // std::cout << "cells.size()" << gd.cells.size() << '\n';
-
-  fin.close();
-}
-
-// SDF generated by SDFGen
-// from https://github.com/christopherbatty
-// note that the <padding> parameter translates the mesh
-// with (dx * padding)
-void readSdfBatty(Grid &gd, const string fileName) {
-  ifstream fin;
-  fin.open(fileName.c_str());
-
-  if (!(fin.good())) {
-    cout << "failed to open file : " << fileName << std::endl;
-  }
-
-  // # of cells
-  fin >> gd.nOfCells.x;
-  fin >> gd.nOfCells.y;
-  fin >> gd.nOfCells.z;
-
-  // origin
-  fin >> gd.origin.x;
-  fin >> gd.origin.y;
-  fin >> gd.origin.z;
-  // assume the origin is always (0, 0, 0)
-  gd.origin = vec3(0);
-
-  // cell size
-  fin >> gd.cellSize;
-
-  // read sdf
-  for (size_t k = 0; k < gd.nOfCells.z; k++) {
-    for (size_t j = 0; j < gd.nOfCells.y; j++) {
-      for (size_t i = 0; i < gd.nOfCells.x; i++) {
-        Cell cell;
-
-        cell.pos = vec3(i * gd.cellSize, j * gd.cellSize, k * gd.cellSize);
-        cell.pos += gd.origin;
-
-        // if padding is 1
-        // cell.pos += vec3(gd.cellSize * 1.f);
-        // or translate the mesh instead
-
-        cell.idx = ivec3(i, j, k);
-
-        fin >> cell.sd;
-
-        gd.cells.push_back(cell);
-      }
-    }
-  }
-
-  fin.close();
-}
-
 float randf() {
   // [0, 1]
   float f = static_cast<float>(rand()) / static_cast<float>(RAND_MAX);
@@ -565,7 +458,22 @@ void initGrid() {
   //
   // readSdf(grid, "sdfCube.txt");
 
-  readSdfBatty(grid, "sdfBunnyBatty.txt");
+  if (isBinarySdf(sdfFile)) {
+    // zero copy, samples are read from the mapped file
+    mapSdf(grid, sdfMap, sdfFile);
+  } else {
+    readSdfBatty(grid, sdfFile);
+  }
+
+  // coarse levels written by createSdf -levels, or built here
+  int nOfLevels = 1;
+  if (isBinarySdf(sdfFile)) {
+    nOfLevels = mapSdfPyramid(pyramid, grid, levelMaps, sdfFile);
+  }
+
+  if (nOfLevels == 1) {
+    pyramid.build(grid, 4, pool);
+  }
 }
 
 void initOther() { srand(clock()); }
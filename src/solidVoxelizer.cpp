@@ -1,5 +1,7 @@
 #include "common.h"
 #include "sdf.h"
+#include "bvh.h"
+#include "windingNumber.h"
 
 GLFWwindow *window;
 
@@ -27,6 +29,11 @@ float cellSize = 0.25f;
 vec3 gridOrigin(0, 0, 0);
 vec3 rangeOffset(0.5f, 0.5f, 0.5f);
 
+// inside test
+// false: sign of the closest triangle
+// true: winding number, for meshes with holes
+bool useWinding = false;
+
 /* opengl variables */
 GLuint exeShader;
 GLint uniM, uniV, uniP;
@@ -46,6 +53,19 @@ void writePointCloud(vector<vec3> &, const string);
 vec3 calCellPos(vec3);
 
 int main(int argc, char const *argv[]) {
+  // solidVoxelizer [-sign normal|winding]
+  if (argc > 1) {
+    string opt = argv[1];
+    string val = (argc > 2) ? argv[2] : "";
+
+    if (opt != "-sign" || (val != "normal" && val != "winding")) {
+      cout << "usage: solidVoxelizer [-sign normal|winding]" << '\n';
+      return 1;
+    }
+
+    useWinding = (val == "winding");
+  }
+
   initGL();
   initShader();
   initMatrix();
@@ -63,6 +83,15 @@ int main(int argc, char const *argv[]) {
   mesh.translate(offset);
   updateMesh(mesh);
 
+  // triangles are cached in the bvh once
+  Bvh bvh;
+  bvh.build(mesh);
+
+  WindingNumber wn;
+  if (useWinding) {
+    wn.build(bvh);
+  }
+
   /* grid parameters */
   // The grid covers the area of mesh
   // Between the grid and the mesh,
@@ -146,36 +175,18 @@ int main(int argc, char const *argv[]) {
     for (float y = startCell.y; y < endCell.y; y += cellSize) {
       for (float x = startCell.x; x < endCell.x; x += cellSize) {
         vec3 P(x, y, z); // cell position
-        float dist = 9999.f;
-
-        // iterate triangles in the mesh
-        for (size_t i = 0; i < mesh.faces.size(); i++) {
-          Face face = mesh.faces[i];
 
-          glm::vec3 A, B, C, N;
-          A = mesh.vertices[face.v1];
-          B = mesh.vertices[face.v2];
-          C = mesh.vertices[face.v3];
-          N = mesh.faceNormals[face.vn1];
-
-          float temp = distPoint2Triangle(A, B, C, N, P);
-          float oldDist = dist;
-
-          // for general case
-          dist = (glm::abs(temp) < glm::abs(dist)) ? temp : dist;
-
-          // for a special case
-          float delta = abs(abs(temp) - abs(oldDist));
-          // if delta is less than some threshold
-          // we decide that temp is equal to dist
-          if (delta < 0.0001f) {
-
-            // if dist will change its sign
-            // we keep dist at the positive one
-            dist = (temp > 0) ? temp : oldDist;
+        if (useWinding) {
+          // the winding number is about 1 inside
+          if (wn.getWinding(P) > 0.5f) {
+            pointCloud.push_back(P);
           }
 
-        } // end iterate triangles
+          continue;
+        }
+
+        // closest signed distance to the mesh
+        float dist = bvh.getDistance(P);
 
         // use sdf3d as a solid voxelier
         // if dist < threshold, output grid position
@@ -189,6 +200,15 @@ int main(int argc, char const *argv[]) {
 
   writePointCloud(pointCloud, "test.txt");
 
+  // points to draw
+  std::vector<Point> pts;
+  for (size_t i = 0; i < pointCloud.size(); i++) {
+    Point p;
+    p.pos = pointCloud[i];
+    p.color = vec3(0.5, 0.5, 0.5);
+    pts.push_back(p);
+  }
+
   /* glfw loop */
   // a rough way to solve cursor position initialization problem
   // must call glfwPollEvents once to activate glfwSetCursorPos
@@ -226,6 +246,7 @@ int main(int argc, char const *argv[]) {
     glfwPollEvents();
   }
 
+  releaseMesh(mesh);
   releaseResource();
 
   return 0;
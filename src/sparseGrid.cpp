@@ -0,0 +1,255 @@
+#include "sparseGrid.h"
+
+// Pack the index of an internal node into a root key
+// Each component is offset by 2^20, so negative indices are fine.
+uint64_t sparseKey(ivec3 idx) {
+  uint64_t x = uint64_t(idx.x + (1 << 20)) & 0x1fffff;
+  uint64_t y = uint64_t(idx.y + (1 << 20)) & 0x1fffff;
+  uint64_t z = uint64_t(idx.z + (1 << 20)) & 0x1fffff;
+
+  return x | (y << 21) | (z << 42);
+}
+
+// child of a node, or sample of a leaf, from the index in cells
+static inline int childOffset(ivec3 idx) {
+  int m = SPARSE_NODE_SIZE - 1;
+  int x = (idx.x >> BRICK_LOG2) & m;
+  int y = (idx.y >> BRICK_LOG2) & m;
+  int z = (idx.z >> BRICK_LOG2) & m;
+
+  return x + (y << SPARSE_NODE_LOG2) + (z << (2 * SPARSE_NODE_LOG2));
+}
+
+static inline int leafOffset(ivec3 idx) {
+  int m = BRICK_SIZE - 1;
+
+  return (idx.x & m) + ((idx.y & m) << BRICK_LOG2) +
+         ((idx.z & m) << (2 * BRICK_LOG2));
+}
+
+/* Member functions of SparseGrid */
+// Set the grid parameters and drop all nodes and leaves
+void SparseGrid::init(vec3 gridOrigin, float size, ivec3 n, float value) {
+  origin = gridOrigin;
+  cellSize = size;
+  nOfCells = n;
+  background = value;
+
+  root.clear();
+  nodeIdxs.clear();
+  nodeChildren.clear();
+  nodeTiles.clear();
+  leafIdxs.clear();
+  leafSamples.clear();
+}
+
+// Return the internal node of nodeIdx (in nodes), create it if needed
+// All children of a new node are tiles of the value it replaces.
+int SparseGrid::addNode(ivec3 nodeIdx) {
+  uint64_t key = sparseKey(nodeIdx);
+  auto it = root.find(key);
+
+  float tile = background;
+  if (it != root.end()) {
+    if (it->second.node != SPARSE_TILE) {
+      return it->second.node;
+    }
+    tile = it->second.tile;
+  }
+
+  int node = nodeIdxs.size();
+  nodeIdxs.push_back(nodeIdx);
+  nodeChildren.resize(nodeChildren.size() + SPARSE_NODE_CHILDREN, -1);
+  nodeTiles.resize(nodeTiles.size() + SPARSE_NODE_CHILDREN, tile);
+
+  RootEntry entry;
+  entry.node = node;
+  entry.tile = tile;
+  root[key] = entry;
+
+  return node;
+}
+
+// Return the leaf of leafIdx (in bricks), create it if needed
+// A new leaf is filled with the tile value it replaces.
+int SparseGrid::addLeaf(ivec3 leafIdx) {
+  ivec3 nodeIdx(leafIdx.x >> SPARSE_NODE_LOG2, leafIdx.y >> SPARSE_NODE_LOG2,
+                leafIdx.z >> SPARSE_NODE_LOG2);
+  int node = addNode(nodeIdx);
+
+  size_t child = size_t(node) * SPARSE_NODE_CHILDREN +
+                 childOffset(leafIdx * BRICK_SIZE);
+
+  if (nodeChildren[child] >= 0) {
+    return nodeChildren[child];
+  }
+
+  int leaf = leafIdxs.size();
+  leafIdxs.push_back(leafIdx);
+  leafSamples.resize(leafSamples.size() + BRICK_CELLS, nodeTiles[child]);
+  nodeChildren[child] = leaf;
+
+  return leaf;
+}
+
+// Let the whole internal node nodeIdx read value
+// Must not be called on a node which has been added.
+void SparseGrid::setRootTile(ivec3 nodeIdx, float value) {
+  RootEntry entry;
+  entry.node = SPARSE_TILE;
+  entry.tile = value;
+
+  root[sparseKey(nodeIdx)] = entry;
+}
+
+// Return the samples of the leaf containing the cell idx,
+// or NULL and the tile value if there is no leaf
+const float *SparseGrid::findLeaf(ivec3 idx, float &tile) {
+  ivec3 nodeIdx(idx.x >> SPARSE_NODE_CELLS_LOG2,
+                idx.y >> SPARSE_NODE_CELLS_LOG2,
+                idx.z >> SPARSE_NODE_CELLS_LOG2);
+
+  auto it = root.find(sparseKey(nodeIdx));
+
+  if (it == root.end()) {
+    tile = background;
+    return NULL;
+  }
+  if (it->second.node == SPARSE_TILE) {
+    tile = it->second.tile;
+    return NULL;
+  }
+
+  size_t child = size_t(it->second.node) * SPARSE_NODE_CHILDREN +
+                 childOffset(idx);
+  int leaf = nodeChildren[child];
+
+  if (leaf < 0) {
+    tile = nodeTiles[child];
+    return NULL;
+  }
+
+  return &leafSamples[size_t(leaf) * BRICK_CELLS];
+}
+
+// Signed distance of the cell idx
+float SparseGrid::getValue(ivec3 idx) {
+  float tile;
+  const float *leaf = findLeaf(idx, tile);
+
+  return leaf ? leaf[leafOffset(idx)] : tile;
+}
+
+// Set the signed distance of the cell idx, a leaf is added if needed
+void SparseGrid::setValue(ivec3 idx, float value) {
+  ivec3 leafIdx(idx.x >> BRICK_LOG2, idx.y >> BRICK_LOG2,
+                idx.z >> BRICK_LOG2);
+  int leaf = addLeaf(leafIdx);
+
+  leafSamples[size_t(leaf) * BRICK_CELLS + leafOffset(idx)] = value;
+}
+
+vec3 SparseGrid::getPos(ivec3 idx) { return vec3(idx) * cellSize + origin; }
+
+// retrieve signed distance by point position, same as Grid
+float SparseGrid::getDistance(vec3 p) {
+  // transform to the reference frame of the grid
+  vec3 u = (p - origin) / cellSize;
+
+  if (!(u.x >= 0.f && u.x < nOfCells.x && u.y >= 0.f && u.y < nOfCells.y &&
+        u.z >= 0.f && u.z < nOfCells.z)) {
+    return 9999.f;
+  }
+
+  return getValue(ivec3(floor(u)));
+}
+
+// Trilinear signed distance and its analytic gradient at p
+// Same as Grid::getDistanceGradient(). The gradient is zero
+// where all 8 corners read the same tile value.
+float SparseGrid::getDistanceGradient(vec3 p, vec3 &grad) {
+  // transform to grid space
+  vec3 u = (p - origin) / cellSize;
+
+  // written as "not inside" so that NaN is outside
+  if (!(u.x >= 0.f && u.x < nOfCells.x && u.y >= 0.f && u.y < nOfCells.y &&
+        u.z >= 0.f && u.z < nOfCells.z)) {
+    grad = vec3(0);
+    return 9999.f;
+  }
+
+  // lower corner, the last layer of cells uses the cell below it
+  ivec3 i0 = glm::max(glm::min(ivec3(u), nOfCells - 2), ivec3(0));
+  ivec3 i1 = glm::min(i0 + 1, nOfCells - 1);
+  vec3 t = glm::clamp(u - vec3(i0), vec3(0), vec3(1));
+
+  float d[8];
+
+  // most cells have all corners in one leaf,
+  // then the tree is walked once instead of 8 times
+  bool sameLeaf = (i0.x >> BRICK_LOG2) == (i1.x >> BRICK_LOG2) &&
+                  (i0.y >> BRICK_LOG2) == (i1.y >> BRICK_LOG2) &&
+                  (i0.z >> BRICK_LOG2) == (i1.z >> BRICK_LOG2);
+
+  if (sameLeaf) {
+    float tile;
+    const float *leaf = findLeaf(i0, tile);
+
+    for (int c = 0; c < 8; c++) {
+      ivec3 idx((c & 1) ? i1.x : i0.x, (c & 2) ? i1.y : i0.y,
+                (c & 4) ? i1.z : i0.z);
+      d[c] = leaf ? leaf[leafOffset(idx)] : tile;
+    }
+  } else {
+    for (int c = 0; c < 8; c++) {
+      ivec3 idx((c & 1) ? i1.x : i0.x, (c & 2) ? i1.y : i0.y,
+                (c & 4) ? i1.z : i0.z);
+      d[c] = getValue(idx);
+    }
+  }
+
+  float d000 = d[0], d100 = d[1], d010 = d[2], d110 = d[3];
+  float d001 = d[4], d101 = d[5], d011 = d[6], d111 = d[7];
+
+  // along x
+  float d00 = d000 + t.x * (d100 - d000);
+  float d10 = d010 + t.x * (d110 - d010);
+  float d01 = d001 + t.x * (d101 - d001);
+  float d11 = d011 + t.x * (d111 - d011);
+
+  // along y
+  float d0 = d00 + t.y * (d10 - d00);
+  float d1 = d01 + t.y * (d11 - d01);
+
+  // derivatives of the interpolant in grid space
+  float gx0 = (d100 - d000) + t.y * ((d110 - d010) - (d100 - d000));
+  float gx1 = (d101 - d001) + t.y * ((d111 - d011) - (d101 - d001));
+
+  grad.x = gx0 + t.z * (gx1 - gx0);
+  grad.y = (d10 - d00) + t.z * ((d11 - d01) - (d10 - d00));
+  grad.z = d1 - d0;
+  grad /= cellSize;
+
+  return d0 + t.z * (d1 - d0);
+}
+
+// Same as Grid::getGradient()
+vec3 SparseGrid::getGradient(vec3 p) {
+  float gx = getDistance(vec3(p.x + cellSize, p.y, p.z)) -
+             getDistance(vec3(p.x - cellSize, p.y, p.z));
+
+  float gy = getDistance(vec3(p.x, p.y + cellSize, p.z)) -
+             getDistance(vec3(p.x, p.y - cellSize, p.z));
+
+  float gz = getDistance(vec3(p.x, p.y, p.z + cellSize)) -
+             getDistance(vec3(p.x, p.y, p.z - cellSize));
+
+  return normalize(-vec3(gx, gy, gz));
+}
+
+// # of bytes of nodes and leaves, the root is not counted
+size_t SparseGrid::getMemorySize() {
+  return nodeIdxs.size() * sizeof(ivec3) + nodeChildren.size() * sizeof(int) +
+         nodeTiles.size() * sizeof(float) + leafIdxs.size() * sizeof(ivec3) +
+         leafSamples.size() * sizeof(float);
+}
@@ -0,0 +1,68 @@
+#include "spatialHash.h"
+
+// # of points hashed by one task of build()
+#define HASH_GRAIN 65536
+
+/* Member functions of SpatialHash */
+// Sort count points into cells of size
+// The table has at least minBuckets buckets, more buckets than points
+// keep the points of far cells out of the buckets around a point.
+void SpatialHash::build(const float *px, const float *py, const float *pz,
+                        int count, float size, ThreadPool &pool,
+                        int minBuckets) {
+  cellSize = size;
+
+  tableBits = 6;
+  while ((1 << tableBits) < glm::max(count, minBuckets) && tableBits < 30) {
+    tableBits++;
+  }
+  bits = ivec3((tableBits + 2) / 3, (tableBits + 1) / 3, tableBits / 3);
+
+  keys.resize(count);
+  order.resize(count);
+
+  pool.parallelFor(0, count, HASH_GRAIN, [&](int begin, int end) {
+    for (int i = begin; i < end; i++) {
+      keys[i] = getBucket(getCell(vec3(px[i], py[i], pz[i])));
+      order[i] = i;
+    }
+  });
+
+  radixSort(keys, order, tableBits, pool);
+
+  size_t nOfBuckets = size_t(1) << tableBits;
+  starts.resize(nOfBuckets + 1);
+  xs.resize(count);
+  ys.resize(count);
+  zs.resize(count);
+
+  // point i starts its bucket and the empty buckets before it
+  pool.parallelFor(0, count, HASH_GRAIN, [&](int begin, int end) {
+    for (int i = begin; i < end; i++) {
+      uint32_t first = (i == 0) ? 0 : keys[i - 1] + 1;
+
+      for (uint32_t b = first; b <= keys[i]; b++) {
+        starts[b] = i;
+      }
+
+      xs[i] = px[order[i]];
+      ys[i] = py[order[i]];
+      zs[i] = pz[order[i]];
+    }
+  });
+
+  // empty buckets after the last point
+  size_t last = (count > 0) ? keys[count - 1] + 1 : 0;
+  for (size_t b = last; b <= nOfBuckets; b++) {
+    starts[b] = count;
+  }
+}
+
+// Bucket of the cell idx
+uint32_t SpatialHash::getBucket(ivec3 idx) {
+  uint32_t x = uint32_t(idx.x) & ((1u << bits.x) - 1);
+  uint32_t y = uint32_t(idx.y) & ((1u << bits.y) - 1);
+  uint32_t z = uint32_t(idx.z) & ((1u << bits.z) - 1);
+
+  return x | (y << bits.x) | (z << (bits.x + bits.y));
+}
@@ -0,0 +1,156 @@
+#include "threadPool.h"
+
+/* Member functions of TaskQueue */
+void TaskQueue::push(Task t) {
+  lock_guard<mutex> lock(m);
+  tasks.push_back(t);
+}
+
+bool TaskQueue::pop(Task &t) {
+  lock_guard<mutex> lock(m);
+
+  if (tasks.empty()) {
+    return false;
+  }
+
+  t = tasks.back();
+  tasks.pop_back();
+
+  return true;
+}
+
+bool TaskQueue::steal(Task &t) {
+  lock_guard<mutex> lock(m);
+
+  if (tasks.empty()) {
+    return false;
+  }
+
+  t = tasks.front();
+  tasks.pop_front();
+
+  return true;
+}
+
+/* Member functions of ThreadPool */
+// # of hardware threads, at least 1
+static int hardwareThreads() {
+  int n = thread::hardware_concurrency();
+
+  return (n > 0) ? n : 1;
+}
+
+ThreadPool::ThreadPool(int n)
+    : nOfThreads(n > 0 ? n : hardwareThreads()), queues(nOfThreads),
+      job(NULL), remaining(0), generation(0), quit(false) {
+  // worker 0 is the thread calling parallelFor()
+  for (int i = 1; i < nOfThreads; i++) {
+    workers.push_back(thread(&ThreadPool::workerLoop, this, i));
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    lock_guard<mutex> lock(m);
+    quit = true;
+  }
+  cvStart.notify_all();
+
+  for (size_t i = 0; i < workers.size(); i++) {
+    workers[i].join();
+  }
+}
+
+// Call func(chunkBegin, chunkEnd) for chunks covering [begin, end)
+// Return after all chunks are done
+void ThreadPool::parallelFor(int begin, int end, int grain,
+                             const function<void(int, int)> &func) {
+  if (end <= begin) {
+    return;
+  }
+
+  grain = (grain > 0) ? grain : 1;
+
+  // single thread, or nothing worth splitting
+  if (nOfThreads == 1 || end - begin <= grain) {
+    func(begin, end);
+    return;
+  }
+
+  // deal chunks to the workers in contiguous blocks,
+  // so that neighbouring chunks start on the same worker
+  int nOfTasks = (end - begin + grain - 1) / grain;
+  int perWorker = (nOfTasks + nOfThreads - 1) / nOfThreads;
+
+  // job must be visible before any task can be popped
+  {
+    lock_guard<mutex> lock(m);
+    job = &func;
+  }
+
+  remaining = nOfTasks;
+
+  for (int i = 0; i < nOfTasks; i++) {
+    Task t;
+    t.begin = begin + i * grain;
+    t.end = (t.begin + grain < end) ? t.begin + grain : end;
+
+    queues[i / perWorker].push(t);
+  }
+
+  {
+    lock_guard<mutex> lock(m);
+    generation++;
+  }
+  cvStart.notify_all();
+
+  runTasks(0);
+
+  // wait for chunks stolen by other workers
+  unique_lock<mutex> lock(m);
+  cvDone.wait(lock, [this] { return remaining == 0; });
+  job = NULL;
+}
+
+void ThreadPool::workerLoop(int id) {
+  unsigned int seen = 0;
+
+  while (true) {
+    {
+      unique_lock<mutex> lock(m);
+      cvStart.wait(lock, [&] { return quit || generation != seen; });
+
+      if (quit) {
+        return;
+      }
+
+      seen = generation;
+    }
+
+    runTasks(id);
+  }
+}
+
+// Run own tasks first, then steal from the others
+void ThreadPool::runTasks(int id) {
+  Task t;
+
+  while (true) {
+    bool found = queues[id].pop(t);
+
+    for (int i = 1; !found && i < nOfThreads; i++) {
+      found = queues[(id + i) % nOfThreads].steal(t);
+    }
+
+    if (!found) {
+      return;
+    }
+
+    (*job)(t.begin, t.end);
+
+    if (--remaining == 0) {
+      lock_guard<mutex> lock(m);
+      cvDone.notify_all();
+    }
+  }
+}
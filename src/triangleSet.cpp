@@ -0,0 +1,261 @@
+#include "triangleSet.h"
+
+// 1 / x, or 0 for a degenerate triangle
+static float safeInverse(float x) { return (x > 0) ? 1.f / x : 0.f; }
+
+/* Member functions of TriangleSet */
+// Triangles in the order of Mesh::faces
+void TriangleSet::build(Mesh &mesh) {
+  vector<int> order(mesh.faces.size());
+
+  for (size_t i = 0; i < order.size(); i++) {
+    order[i] = i;
+  }
+
+  build(mesh, order);
+}
+
+// Triangle i is Mesh::faces[order[i]]
+void TriangleSet::build(Mesh &mesh, vector<int> &order) {
+  nOfTris = order.size();
+  faceIdxs = order;
+
+  // pad with degenerate triangles at (0, 0, 0),
+  // so that the last batch can always be loaded at once
+  int padded = (nOfTris + 15) / 16 * 16;
+
+  FloatArray *arrays[] = {&ax,      &ay,      &az,      &bx,       &by,
+                          &bz,      &cx,      &cy,      &cz,       &abx,
+                          &aby,     &abz,     &acx,     &acy,      &acz,
+                          &nx,      &ny,      &nz,      &abab,     &abac,
+                          &acac,    &invAbab, &invAcac, &invBcbc,  &invArea2};
+  for (size_t i = 0; i < sizeof(arrays) / sizeof(arrays[0]); i++) {
+    arrays[i]->assign(padded, 0.f);
+  }
+
+  for (int i = 0; i < nOfTris; i++) {
+    Face &face = mesh.faces[order[i]];
+
+    vec3 A = mesh.vertices[face.v1];
+    vec3 B = mesh.vertices[face.v2];
+    vec3 C = mesh.vertices[face.v3];
+    vec3 N = mesh.faceNormals[face.vn1];
+
+    vec3 AB = B - A;
+    vec3 AC = C - A;
+
+    ax[i] = A.x;
+    ay[i] = A.y;
+    az[i] = A.z;
+
+    bx[i] = B.x;
+    by[i] = B.y;
+    bz[i] = B.z;
+
+    cx[i] = C.x;
+    cy[i] = C.y;
+    cz[i] = C.z;
+
+    abx[i] = AB.x;
+    aby[i] = AB.y;
+    abz[i] = AB.z;
+
+    acx[i] = AC.x;
+    acy[i] = AC.y;
+    acz[i] = AC.z;
+
+    nx[i] = N.x;
+    ny[i] = N.y;
+    nz[i] = N.z;
+
+    abab[i] = dot(AB, AB);
+    abac[i] = dot(AB, AC);
+    acac[i] = dot(AC, AC);
+
+    invAbab[i] = safeInverse(abab[i]);
+    invAcac[i] = safeInverse(acac[i]);
+    invBcbc[i] = safeInverse(dot(C - B, C - B));
+    invArea2[i] = safeInverse(abab[i] * acac[i] - abac[i] * abac[i]);
+  }
+}
+
+// Distance between a point and the t-th triangle
+// Same Voronoi regions as distPoint2Triangle(a, b, c, n, p),
+// but written with dot products only (see Erin Catto's article).
+// The closest point is A + v * AB + w * AC.
+// Note: d1 - d3 = |AB|^2, d2 - d6 = |AC|^2,
+// (d4 - d3) + (d5 - d6) = |BC|^2 and va + vb + vc = |cross(AB, AC)|^2,
+// so every division is a multiplication by a precomputed inverse.
+float distPoint2Triangle(TriangleSet &ts, int t, vec3 p) {
+  vec3 ab(ts.abx[t], ts.aby[t], ts.abz[t]);
+  vec3 ac(ts.acx[t], ts.acy[t], ts.acz[t]);
+  vec3 ap = p - vec3(ts.ax[t], ts.ay[t], ts.az[t]);
+
+  // dot(AB, AP), dot(AC, AP), dot(AB, BP), dot(AC, BP),
+  // dot(AB, CP), dot(AC, CP)
+  float d1 = dot(ab, ap);
+  float d2 = dot(ac, ap);
+  float d3 = d1 - ts.abab[t];
+  float d4 = d2 - ts.abac[t];
+  float d5 = d1 - ts.abac[t];
+  float d6 = d2 - ts.acac[t];
+
+  // (unnormalized) barycentric coordinate of P'
+  float va = d3 * d6 - d5 * d4;
+  float vb = d5 * d2 - d1 * d6;
+  float vc = d1 * d4 - d3 * d2;
+
+  float v, w;
+
+  // first: vertex and edge regions
+  if (d1 <= 0 && d2 <= 0) { // region A
+    v = 0.f;
+    w = 0.f;
+  } else if (d3 >= 0 && d4 <= d3) { // region B
+    v = 1.f;
+    w = 0.f;
+  } else if (vc <= 0 && d1 >= 0 && d3 <= 0) { // region AB
+    v = d1 * ts.invAbab[t];
+    w = 0.f;
+  } else if (d6 >= 0 && d5 <= d6) { // region C
+    v = 0.f;
+    w = 1.f;
+  } else if (vb <= 0 && d2 >= 0 && d6 <= 0) { // region CA
+    v = 0.f;
+    w = d2 * ts.invAcac[t];
+  } else if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0) { // region BC
+    w = (d4 - d3) * ts.invBcbc[t];
+    v = 1.f - w;
+  }
+  // second: P' is inside ABC
+  else {
+    v = vb * ts.invArea2[t];
+    w = vc * ts.invArea2[t];
+  }
+
+  float dist = length(ap - v * ab - w * ac);
+
+  // sign, same rule as distPoint2Triangle(a, b, c, n, p)
+  float temp = ap.x * ts.nx[t] + ap.y * ts.ny[t] + ap.z * ts.nz[t];
+  float sign = (temp <= -SIGN_EPSILON) ? -1.f : 1.f;
+
+  return dist * sign;
+}
+
+#if TRI_LANES > 1
+// Distances between P and triangles [t, t + TRI_LANES)
+// Every region is evaluated, then selected in the reverse order
+// of the if-else chain in the scalar version.
+static void distLanes(TriangleSet &ts, int t, vfloat px, vfloat py,
+                      vfloat pz, float *out) {
+  vfloat zero = vSet(0.f);
+  vfloat one = vSet(1.f);
+
+  vfloat abx = vLoad(&ts.abx[t]), aby = vLoad(&ts.aby[t]),
+         abz = vLoad(&ts.abz[t]);
+  vfloat acx = vLoad(&ts.acx[t]), acy = vLoad(&ts.acy[t]),
+         acz = vLoad(&ts.acz[t]);
+  vfloat apx = vSub(px, vLoad(&ts.ax[t]));
+  vfloat apy = vSub(py, vLoad(&ts.ay[t]));
+  vfloat apz = vSub(pz, vLoad(&ts.az[t]));
+
+  vfloat abac = vLoad(&ts.abac[t]);
+
+  vfloat d1 = vDot(abx, aby, abz, apx, apy, apz);
+  vfloat d2 = vDot(acx, acy, acz, apx, apy, apz);
+  vfloat d3 = vSub(d1, vLoad(&ts.abab[t]));
+  vfloat d4 = vSub(d2, abac);
+  vfloat d5 = vSub(d1, abac);
+  vfloat d6 = vSub(d2, vLoad(&ts.acac[t]));
+
+  vfloat va = vSub(vMul(d3, d6), vMul(d5, d4));
+  vfloat vb = vSub(vMul(d5, d2), vMul(d1, d6));
+  vfloat vc = vSub(vMul(d1, d4), vMul(d3, d2));
+
+  // inside ABC
+  vfloat invArea2 = vLoad(&ts.invArea2[t]);
+  vfloat v = vMul(vb, invArea2);
+  vfloat w = vMul(vc, invArea2);
+  vmask m;
+
+  // region BC
+  vfloat e43 = vSub(d4, d3);
+  vfloat e56 = vSub(d5, d6);
+  vfloat wBc = vMul(e43, vLoad(&ts.invBcbc[t]));
+  m = vAnd(vAnd(vLe(va, zero), vLe(zero, e43)), vLe(zero, e56));
+  v = vSelect(m, vSub(one, wBc), v);
+  w = vSelect(m, wBc, w);
+
+  // region CA
+  m = vAnd(vAnd(vLe(vb, zero), vLe(zero, d2)), vLe(d6, zero));
+  v = vSelect(m, zero, v);
+  w = vSelect(m, vMul(d2, vLoad(&ts.invAcac[t])), w);
+
+  // region C
+  m = vAnd(vLe(zero, d6), vLe(d5, d6));
+  v = vSelect(m, zero, v);
+  w = vSelect(m, one, w);
+
+  // region AB
+  m = vAnd(vAnd(vLe(vc, zero), vLe(zero, d1)), vLe(d3, zero));
+  v = vSelect(m, vMul(d1, vLoad(&ts.invAbab[t])), v);
+  w = vSelect(m, zero, w);
+
+  // region B
+  m = vAnd(vLe(zero, d3), vLe(d4, d3));
+  v = vSelect(m, one, v);
+  w = vSelect(m, zero, w);
+
+  // region A
+  m = vAnd(vLe(d1, zero), vLe(d2, zero));
+  v = vSelect(m, zero, v);
+  w = vSelect(m, zero, w);
+
+  // P - closest point
+  vfloat dx = vSub(vSub(apx, vMul(v, abx)), vMul(w, acx));
+  vfloat dy = vSub(vSub(apy, vMul(v, aby)), vMul(w, acy));
+  vfloat dz = vSub(vSub(apz, vMul(v, abz)), vMul(w, acz));
+  vfloat dist = vSqrt(vDot(dx, dy, dz, dx, dy, dz));
+
+  // sign
+  vfloat temp = vDot(apx, apy, apz, vLoad(&ts.nx[t]), vLoad(&ts.ny[t]),
+                     vLoad(&ts.nz[t]));
+  m = vLe(temp, vSet(-SIGN_EPSILON));
+  vfloat sign = vSelect(m, vSet(-1.f), one);
+
+  vStore(out, vMul(dist, sign));
+}
+#endif
+
+// Signed distances between P and triangles [first, first + count)
+// out[i] is the distance to triangle (first + i)
+void distPoint2Triangles(TriangleSet &ts, int first, int count, vec3 p,
+                         float *out) {
+  int i = first;
+  int last = first + count;
+
+#if TRI_LANES > 1
+  vfloat px = vSet(p.x), py = vSet(p.y), pz = vSet(p.z);
+
+  for (; i + TRI_LANES <= last; i += TRI_LANES) {
+    distLanes(ts, i, px, py, pz, out + (i - first));
+  }
+
+  // the padding allows the remainder to be loaded as a full batch
+  if (i < last && i + TRI_LANES <= int(ts.ax.size())) {
+    float temp[TRI_LANES];
+    int base = i;
+    distLanes(ts, base, px, py, pz, temp);
+
+    for (; i < last; i++) {
+      out[i - first] = temp[i - base];
+    }
+  }
+
+  vEnd();
+#endif
+
+  for (; i < last; i++) {
+    out[i - first] = distPoint2Triangle(ts, i, p);
+  }
+}
@@ -0,0 +1,126 @@
+#include "windingNumber.h"
+
+// Solid angle of a triangle seen from the origin
+// a, b, c: vertices relative to the query point, counter-clockwise
+// [Van Oosterom,1983]
+float solidAngle(vec3 a, vec3 b, vec3 c) {
+  float la = length(a);
+  float lb = length(b);
+  float lc = length(c);
+
+  float det = dot(a, cross(b, c));
+  float div = la * lb * lc + dot(a, b) * lc + dot(b, c) * la + dot(c, a) * lb;
+
+  return 2.f * atan2(det, div);
+}
+
+/* Member functions of WindingNumber */
+void WindingNumber::build(Bvh &tree) {
+  bvh = &tree;
+
+  int nOfNodes = bvh->nodes.size();
+  TriangleSet &tris = bvh->tris;
+
+  centers.assign(nOfNodes, vec3(0));
+  areaNormals.assign(nOfNodes, vec3(0));
+  radii.assign(nOfNodes, 0.f);
+  vector<float> areas(nOfNodes, 0.f);
+
+  // children always have larger indices than their parent,
+  // so iterating backwards visits children first
+  for (int i = nOfNodes - 1; i >= 0; i--) {
+    BvhNode &node = bvh->nodes[i];
+
+    // leaf: sum over triangles
+    if (node.left < 0) {
+      vec3 center(0);
+      float area = 0.f;
+
+      for (int t = node.first; t < node.first + node.count; t++) {
+        vec3 A(tris.ax[t], tris.ay[t], tris.az[t]);
+        vec3 B(tris.bx[t], tris.by[t], tris.bz[t]);
+        vec3 C(tris.cx[t], tris.cy[t], tris.cz[t]);
+
+        vec3 an = 0.5f * cross(B - A, C - A);
+        float a = length(an);
+
+        areaNormals[i] += an;
+        center += a * (A + B + C) / 3.f;
+        area += a;
+      }
+
+      centers[i] = (area > 0) ? center / area : (node.min + node.max) * 0.5f;
+      areas[i] = area;
+
+      // farthest vertex from the center
+      for (int t = node.first; t < node.first + node.count; t++) {
+        vec3 A(tris.ax[t], tris.ay[t], tris.az[t]);
+        vec3 B(tris.bx[t], tris.by[t], tris.bz[t]);
+        vec3 C(tris.cx[t], tris.cy[t], tris.cz[t]);
+
+        radii[i] = glm::max(radii[i], length(A - centers[i]));
+        radii[i] = glm::max(radii[i], length(B - centers[i]));
+        radii[i] = glm::max(radii[i], length(C - centers[i]));
+      }
+    }
+    // internal node: combine children
+    else {
+      int l = node.left, r = node.right;
+      float area = areas[l] + areas[r];
+
+      areaNormals[i] = areaNormals[l] + areaNormals[r];
+      centers[i] = (area > 0)
+                       ? (areas[l] * centers[l] + areas[r] * centers[r]) / area
+                       : (node.min + node.max) * 0.5f;
+      areas[i] = area;
+
+      radii[i] = glm::max(length(centers[l] - centers[i]) + radii[l],
+                          length(centers[r] - centers[i]) + radii[r]);
+    }
+  } // end iterate nodes
+}
+
+// Generalized winding number of the mesh at q
+// About 1 inside and 0 outside
+float WindingNumber::getWinding(vec3 q) {
+  if (bvh == NULL || bvh->nodes.empty()) {
+    return 0.f;
+  }
+
+  TriangleSet &tris = bvh->tris;
+
+  // sum of solid angles
+  float omega = 0.f;
+
+  int stack[64];
+  int top = 0;
+  stack[top++] = 0;
+
+  while (top > 0) {
+    int i = stack[--top];
+    BvhNode &node = bvh->nodes[i];
+
+    vec3 d = centers[i] - q;
+    float dist = length(d);
+
+    // far field: solid angle of the dipole
+    if (dist > beta * radii[i]) {
+      omega += dot(d, areaNormals[i]) / (dist * dist * dist);
+    }
+    // leaf: exact solid angles
+    else if (node.left < 0) {
+      for (int t = node.first; t < node.first + node.count; t++) {
+        vec3 A(tris.ax[t], tris.ay[t], tris.az[t]);
+        vec3 B(tris.bx[t], tris.by[t], tris.bz[t]);
+        vec3 C(tris.cx[t], tris.cy[t], tris.cz[t]);
+
+        omega += solidAngle(A - q, B - q, C - q);
+      }
+    } else {
+      stack[top++] = node.left;
+      stack[top++] = node.right;
+    }
+  } // end traverse
+
+  return omega / (4.f * glm::pi<float>());
+}